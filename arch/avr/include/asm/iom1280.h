@@ -46,6 +46,7 @@
 #define SPI_STC_VECTOR_NUM		24
 #define TWI_STC_VECTOR_NUM		39
 #define USART_RX_STC_NUM		25
+#define USART_UDRE_NUM			26
 #define ADC_COMPLETED_NUM		29
 #define TIMER2_OVERFLOW_VECTOR_NUM	15
 
@@ -79,6 +80,7 @@
 #define SPI_STC_VECTOR irq_vector(24)
 #define TWI_STC_VECTOR irq_vector(39)
 #define USART_RX_STC_VECTOR irq_vector(25)
+#define USART_UDRE_VECTOR irq_vector(26)
 #define ADC_COMPLETED_VECTOR irq_vector(29)
 #define TIMER2_OVERFLOW_VECTOR irq_vector(15)
 #define USART1_RX_COMPLETE_VECTOR irq_vector(36)
@@ -34,6 +34,7 @@
 #define SPI_STC_VECTOR_NUM	   17
 #define TWI_STC_VECTOR_NUM	   24
 #define USART_RX_STC_NUM	   18
+#define USART_UDRE_NUM		   19
 #define ADC_COMPLETED_NUM	   21
 #define TIMER2_OVERFLOW_VECTOR_NUM  9
 #define WDT_TMO_VECTOR_NUM          6
@@ -48,6 +49,7 @@
 #define WDT_TMO_VECTOR irq_vector(6)
 #define TIMER0_OVERFLOW_VECTOR irq_vector(16)
 #define USART_RX_STC_VECTOR irq_vector(18)
+#define USART_UDRE_VECTOR irq_vector(19)
 #define SPI_STC_VECTOR irq_vector(17)
 #define TWI_STC_VECTOR irq_vector(24)
 #define ADC_COMPLETED_VECTOR irq_vector(21)
@@ -23,12 +23,14 @@
 #include <etaos/hrtimer.h>
 #include <etaos/delay.h>
 #include <etaos/init.h>
+#include <etaos/irq.h>
 
 #include <asm/timer.h>
 #include <asm/irq.h>
 #include <asm/io.h>
 
 #define AVR_HRTIMER_FREQ 2000
+#define AVR_HRTIMER_PRESCALER 32UL
 
 static struct clocksource avr_hrtimer_src = {
 	.name = "avr-hr-clock",
@@ -49,6 +51,32 @@ static void avr_start_hrclock(int irq, struct clocksource *src)
 	TCCR2B = BIT(WGM22) | BIT(CS20) | BIT(CS21);
 }
 
+/**
+ * @brief Read the hardware counter behind the high resolution clock.
+ * @return The number of CPU cycles since the HR clock was started.
+ *
+ * Timer 2 runs in fast PWM mode with OCR2A as TOP and a prescaler of 32, so
+ * the resolution is 32 cycles. An overflow that is pending, but not yet
+ * handled, is taken into account.
+ */
+unsigned long arch_hrtimer_cycles(void)
+{
+	unsigned long flags, ticks;
+	unsigned char cnt;
+
+	irq_save_and_disable(&flags);
+	ticks = (unsigned long)avr_hrtimer_src.count;
+	cnt = TCNT2;
+
+	if(TIFR2 & BIT(TOV2)) {
+		cnt = TCNT2;
+		ticks++;
+	}
+	irq_restore(&flags);
+
+	return (ticks * (OCR2A + 1UL) + cnt) * AVR_HRTIMER_PRESCALER;
+}
+
 static void __used avr_hrtimer_init(void)
 {
 	clocksource_init(avr_hrtimer_src.name, &avr_hrtimer_src, AVR_HRTIMER_FREQ);
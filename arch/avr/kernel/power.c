@@ -81,3 +81,22 @@ void arch_hibernate(void)
 	barrier();
 }
 
+void arch_hibernate_irq_enable(void)
+{
+	SMCR |= BIT(SE);
+
+	/*
+	 * The instruction following SEI is executed before any pending
+	 * interrupt, so an IRQ can't slip in before the CPU sleeps.
+	 */
+	__asm__ __volatile__(
+			"sei" "\n\t"
+			"sleep" "\n\t"
+			:
+			:
+			: "memory"
+			);
+	SMCR &= ~BIT(SE);
+	barrier();
+}
+
@@ -124,6 +124,9 @@ void sched_create_stack_frame(struct thread *tp, stack_t *stack,
 		return;
 
 	info = &tp->stack;
+#ifdef CONFIG_STACK_WATERMARK
+	memset(stack, STACK_PAINT_BYTE, stack_size);
+#endif
 
 	info->base = stack;
 	info->size = stack_size;
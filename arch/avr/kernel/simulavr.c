@@ -19,6 +19,7 @@
 #include <etaos/kernel.h>
 #include <etaos/types.h>
 #include <etaos/stdio.h>
+#include <etaos/init.h>
 
 #include <asm/io.h>
 #include <asm/simulavr.h>
@@ -63,3 +64,11 @@ void simul_avr_write_string(char *s, struct file * stream)
 	}
 }
 
+#ifdef CONFIG_STDIO_SIMUL_AVR
+static void __used simul_avr_stdio_init(void)
+{
+	simul_avr_setup_streams();
+}
+
+module_init(simul_avr_stdio_init);
+#endif
@@ -77,6 +77,89 @@ static void avr_start_sysclk(int irq, struct clocksource *src)
 	TCCR0B = WGM02 | CS00 | CS01;
 }
 
+#ifdef CONFIG_NO_HZ_IDLE
+/*
+ * While the tick is stopped timer 0 runs with a prescaler of 1024. The
+ * resulting frequency is not a multiple of the system tick frequency, so
+ * the tick can only be stopped for multiples of AVR_NOHZ_UNIT ticks.
+ */
+#if F_CPU == 16000000
+#define AVR_NOHZ_UNIT 8UL
+#elif F_CPU == 8000000
+#define AVR_NOHZ_UNIT 16UL
+#endif
+#define AVR_NOHZ_UNIT_CNT 125UL //!< Timer counts per AVR_NOHZ_UNIT.
+#define AVR_NOHZ_MAX_TICKS (2 * AVR_NOHZ_UNIT) //!< Longest tickless period.
+
+static unsigned long avr_nohz_ticks;
+
+/**
+ * @brief Reprogram timer 0.
+ * @param top Top value of the timer.
+ * @param cs Clock select bits.
+ *
+ * The timer is switched to normal mode while OCR0A is written, since the
+ * compare register is double buffered in PWM mode.
+ */
+static void avr_sysclk_program(uint8_t top, uint8_t cs)
+{
+	TCCR0B = 0;
+	TCCR0A = 0;
+	OCR0A = top;
+	TCNT0 = 0;
+	TIFR0 = TOV;
+	TCCR0A = WGM00 | WGM01;
+	TCCR0B = WGM02 | cs;
+}
+
+unsigned long arch_tick_suspend(unsigned long ticks)
+{
+	if(ticks > AVR_NOHZ_MAX_TICKS)
+		ticks = AVR_NOHZ_MAX_TICKS;
+
+	ticks -= ticks % AVR_NOHZ_UNIT;
+	if(!ticks)
+		return 0;
+
+	avr_nohz_ticks = ticks;
+	avr_sysclk_program(ticks / AVR_NOHZ_UNIT * AVR_NOHZ_UNIT_CNT - 1,
+			CS02 | CS00);
+	return ticks;
+}
+
+unsigned long arch_tick_resume(bool expired)
+{
+	unsigned long ticks;
+	uint8_t cnt;
+
+	if(expired) {
+		ticks = avr_nohz_ticks;
+	} else {
+		/*
+		 * The period can end after the CPU woke up while the IRQs are
+		 * disabled. The overflow flag is cleared when the timer is
+		 * reprogrammed, so the full period has to be accounted here.
+		 */
+		cnt = TCNT0;
+		ticks = 0;
+		if(TIFR0 & TOV) {
+			cnt = TCNT0;
+			ticks = avr_nohz_ticks;
+		}
+
+		ticks += (cnt * AVR_NOHZ_UNIT) / AVR_NOHZ_UNIT_CNT;
+	}
+
+#if F_CPU == 16000000
+	avr_sysclk_program(250, CS00 | CS01);
+#elif F_CPU == 8000000
+	avr_sysclk_program(125, CS00 | CS01);
+#endif
+	avr_nohz_ticks = 0;
+	return ticks;
+}
+#endif
+
 /**
  * @brief Start the AVR timers.
  * @see avr_sysclk_enable avr_start_sysclk
@@ -29,6 +29,16 @@ SIGNAL(USART_RX_STC_VECTOR)
 	chip->chip_handle(USART_RX_STC_NUM);
 }
 
+#ifdef USART_UDRE_VECTOR
+SIGNAL(USART_UDRE_VECTOR)
+{
+	struct irq_chip *chip = arch_get_irq_chip();
+
+	chip->chip_handle(USART_UDRE_NUM);
+	preempt_schedule_irq();
+}
+#endif
+
 #ifdef USART1_UDRE_VECTOR
 SIGNAL(USART1_UDRE_VECTOR)
 {
@@ -0,0 +1,102 @@
+/*
+ *  ETA/OS - Sim bit operations
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_BITOPS_H_
+#define __SIM_BITOPS_H_
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+
+#define BITS_PER_LONG 64UL
+#define BITS_PER_BYTE  8UL
+
+/*
+ * Bits are addressed per byte, like on the AVR, so flag registers of any
+ * width can be used. The operations are atomic with respect to host
+ * signals (i.e. IRQs).
+ */
+#define __sim_bit_byte(nr, addr) \
+	(((volatile unsigned char*)(addr)) + ((nr) / BITS_PER_BYTE))
+#define __sim_bit_mask(nr) ((unsigned char)(1U << ((nr) % BITS_PER_BYTE)))
+
+CDECL
+/**
+ * @brief Clear a bit in register.
+ * @param nr Bit to clear.
+ * @param addr Register that contains \p nr.
+ */
+static inline void clear_bit(unsigned nr, volatile void *addr)
+{
+	__atomic_fetch_and(__sim_bit_byte(nr, addr),
+			(unsigned char)~__sim_bit_mask(nr), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Set a bit in a register.
+ * @param nr Bit to set.
+ * @param addr Register containing \p nr.
+ */
+static inline void set_bit(unsigned nr, volatile void *addr)
+{
+	__atomic_fetch_or(__sim_bit_byte(nr, addr), __sim_bit_mask(nr),
+			__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Return the value of bit \p nr.
+ * @param nr Bit number to test.
+ * @param addr Register that contains \p nr.
+ * @return The value of bit \p nr.
+ */
+static inline int test_bit(unsigned nr, volatile void *addr)
+{
+	return (*__sim_bit_byte(nr, addr) & __sim_bit_mask(nr)) != 0;
+}
+
+/**
+ * @brief Clear a bit and return its old value.
+ * @param nr Bit to clear.
+ * @param addr Register that contains \p nr.
+ * @return The value of \p nr before it was cleared.
+ */
+static inline int test_and_clear_bit(unsigned nr, volatile void *addr)
+{
+	unsigned char old;
+
+	old = __atomic_fetch_and(__sim_bit_byte(nr, addr),
+			(unsigned char)~__sim_bit_mask(nr), __ATOMIC_SEQ_CST);
+	return (old & __sim_bit_mask(nr)) != 0;
+}
+
+/**
+ * @brief Set a bit and return its old value.
+ * @param nr Bit to set.
+ * @param addr Register that contains \p nr.
+ * @return The value of \p nr before it was set.
+ */
+static inline int test_and_set_bit(unsigned nr, volatile void *addr)
+{
+	unsigned char old;
+
+	old = __atomic_fetch_or(__sim_bit_byte(nr, addr), __sim_bit_mask(nr),
+			__ATOMIC_SEQ_CST);
+	return (old & __sim_bit_mask(nr)) != 0;
+}
+CDECL_END
+
+#endif
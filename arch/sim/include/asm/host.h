@@ -0,0 +1,82 @@
+/*
+ *  ETA/OS - Sim host interface
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_HOST_H__
+#define __SIM_HOST_H__
+
+/*
+ * Interface between the kernel and the host (Linux) process. The host side
+ * lives in arch/sim/os and is built against the host C library, so this
+ * header may only use plain C types.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_SYSCLK_IRQ	0 //!< System tick IRQ.
+#define SIM_HRTIMER_IRQ	1 //!< High resolution timer IRQ.
+#define SIM_EXT_IRQ0	2 //!< External IRQ, raised by SIGUSR1.
+#define SIM_EXT_IRQ1	3 //!< External IRQ, raised by SIGUSR2.
+#define SIM_IRQ_NUM	4 //!< Number of IRQ vectors.
+
+struct sim_context;
+
+/**
+ * @brief Host IRQ handler.
+ * @param irq IRQ vector number.
+ */
+typedef void (*sim_irq_handler_t)(int irq);
+
+extern void *sim_host_map(unsigned long size);
+extern void sim_host_unmap(void *addr, unsigned long size);
+
+extern struct sim_context *sim_host_context_create(void (*entry)(void *),
+		void *arg, unsigned long stack_size);
+extern void sim_host_context_destroy(struct sim_context *ctx);
+extern void sim_host_context_switch(struct sim_context *prev,
+		struct sim_context *next);
+
+extern void sim_host_irq_init(sim_irq_handler_t handler);
+extern int sim_host_irq_timer(int irq, unsigned long freq);
+extern void sim_host_irq_raise(int irq);
+extern void sim_host_irq_disable(void);
+extern void sim_host_irq_enable(void);
+extern int sim_host_irq_enabled(void);
+extern void sim_host_idle(void);
+
+extern long sim_host_write(int fd, const void *buf, unsigned long len);
+extern long sim_host_read(int fd, void *buf, unsigned long len);
+extern unsigned long long sim_host_time_ns(void);
+extern void sim_host_delay_us(unsigned int us);
+extern void sim_host_exit(int code);
+
+/**
+ * @brief Kernel entry point.
+ * @note This function doesn't return.
+ *
+ * Called by the host main function after all initialisation functions
+ * have run.
+ */
+extern void sim_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_HOST_H__ */
@@ -0,0 +1,58 @@
+/*
+ *  ETA/OS - Sim initialisation
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_INIT_H__
+#define __SIM_INIT_H__
+
+#ifndef __ASSEMBLER__
+CDECL
+extern void sched_start();
+CDECL_END
+
+/*
+ * Initialisation functions are host constructors. The constructor priority
+ * preserves the order of the AVR init sections: early init, subsystems,
+ * modules, devices and chips.
+ */
+#define SIM_EARLY_INIT_PRIO	101
+#define SIM_SUBSYS_INIT_PRIO	102
+#define SIM_MOD_INIT_PRIO	103
+#define SIM_DEV_INIT_PRIO	104
+#define SIM_CHIP_INIT_PRIO	105
+
+#define SIM_EARLY_ATTRIB __attribute__((constructor(SIM_EARLY_INIT_PRIO)))
+#define SUBSYS_ATTRIB __attribute__((constructor(SIM_SUBSYS_INIT_PRIO)))
+#define MOD_ATTRIB __attribute__((constructor(SIM_MOD_INIT_PRIO)))
+#define DEV_ATTRIB __attribute__((constructor(SIM_DEV_INIT_PRIO)))
+#define CHIP_ATTRIB __attribute__((constructor(SIM_CHIP_INIT_PRIO)))
+
+#define SIM_INIT_CALL(init_fn) init_fn()
+
+#define SUBSYS_INIT_CALL(init_fn) SIM_INIT_CALL(init_fn)
+#define MOD_INIT_CALL(init_fn) SIM_INIT_CALL(init_fn)
+#define DEV_INIT_CALL(init_fn) SIM_INIT_CALL(init_fn)
+#define CHIP_INIT_CALL(init_fn) SIM_INIT_CALL(init_fn)
+
+#ifdef CONFIG_SCHED
+#define sys_init() sched_start();
+#else
+#define sys_init() main_init();
+#endif
+
+#endif /* __ASSEMBLER__ */
+#endif /* __SIM_INIT_H__ */
@@ -0,0 +1,36 @@
+/*
+ *  ETA/OS - Sim I/O definitions
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ARCH_IO_H_
+#define __ARCH_IO_H_
+
+#include <asm/config.h>
+#include <asm/host.h>
+
+#ifndef __ASSEMBLER__
+#include <asm/init.h>
+#endif
+
+#define __noinit
+
+#define CPU_CORE_NUM 1
+
+#define F_CPU CONFIG_FCPU
+#define CONFIG_ARCH_VECTORS SIM_IRQ_NUM
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ *  ETA/OS - Sim IRQ definitions
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_IRQ_H__
+#define __SIM_IRQ_H__
+
+#include <asm/host.h>
+
+#define __isr __attribute__((used, externally_visible))
+
+#define EXT_IRQ0_VECTOR_NUM SIM_EXT_IRQ0
+#define EXT_IRQ1_VECTOR_NUM SIM_EXT_IRQ1
+
+#ifndef __ASSEMBLER__
+CDECL
+extern void arch_irq_disable(void);
+extern void arch_irq_enable(void);
+extern void sim_irq_init(void);
+CDECL_END
+#endif /* __ASSEMBLER__ */
+
+#endif /* __SIM_IRQ_H__ */
@@ -0,0 +1,33 @@
+/*
+ *  ETA/OS - Sim types
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIM_TYPES_H_
+#define __SIM_TYPES_H_
+
+typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
+
+typedef int int32_t;
+typedef long long int64_t;
+
+typedef unsigned long arch_size_t;
+typedef long arch_ssize_t;
+
+typedef unsigned char stack_t;
+
+#endif
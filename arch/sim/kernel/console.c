@@ -0,0 +1,129 @@
+/*
+ *  ETA/OS - Sim console
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sim
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/irq.h>
+#include <etaos/stdio.h>
+#include <etaos/init.h>
+
+#include <asm/io.h>
+#include <asm/host.h>
+#include <asm/sim.h>
+
+#define SIM_CONSOLE_BUFFER 128
+
+static char sim_console_buffer[SIM_CONSOLE_BUFFER];
+static size_t sim_console_length;
+
+static int sim_console_flush(struct file *stream)
+{
+	unsigned long flags;
+
+	irq_save_and_disable(&flags);
+	if(sim_console_length)
+		sim_host_write(1, sim_console_buffer, sim_console_length);
+	sim_console_length = 0;
+	irq_restore(&flags);
+
+	return 0;
+}
+
+/*
+ * Console output is line buffered, a host write per byte would dominate
+ * the profile of any application that prints.
+ */
+static int sim_console_put(int c, struct file *stream)
+{
+	unsigned long flags;
+	bool flush;
+
+	irq_save_and_disable(&flags);
+	sim_console_buffer[sim_console_length++] = (char)c;
+	flush = c == '\n' || sim_console_length == SIM_CONSOLE_BUFFER;
+	irq_restore(&flags);
+
+	if(flush)
+		sim_console_flush(stream);
+
+	return c;
+}
+
+static int sim_console_write(struct file *stream, const void *buff,
+		size_t len)
+{
+	const char *data = buff;
+	size_t idx;
+
+	for(idx = 0; idx < len; idx++)
+		sim_console_put(data[idx], stream);
+
+	return (int)len;
+}
+
+static int sim_console_read(struct file *stream, void *buff, size_t len)
+{
+	return (int)sim_host_read(0, buff, len);
+}
+
+static int sim_console_get(struct file *stream)
+{
+	unsigned char c;
+
+	if(sim_host_read(0, &c, 1) != 1)
+		return -1;
+
+	return c;
+}
+
+static FDEV_SETUP_STREAM(sim_console_stream,
+			 &sim_console_write,
+			 &sim_console_read,
+			 &sim_console_put,
+			 &sim_console_get,
+			 &sim_console_flush,
+			 "SIM_CONSOLE",
+			 _FDEV_SETUP_RW,
+			 NULL);
+
+/**
+ * @brief Exit the simulation.
+ * @param code Exit code of the host process.
+ */
+void sim_exit(int code)
+{
+	sim_console_flush(&sim_console_stream);
+	sim_host_exit(code);
+}
+
+static void __used sim_console_init(void)
+{
+	stdout = &sim_console_stream;
+	stdin = &sim_console_stream;
+	stderr = &sim_console_stream;
+	iob_add(&sim_console_stream);
+}
+
+module_init(sim_console_init);
+
+/* @} */
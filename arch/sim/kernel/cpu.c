@@ -0,0 +1,53 @@
+/*
+ *  ETA/OS - Sim CPU
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sim
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/irq.h>
+#include <etaos/list.h>
+
+#include <asm/io.h>
+
+#ifdef CONFIG_IRQ_SUPPORT
+static struct irq_chip sim_irq_chip = {
+	.name = "sim_irq_chip",
+	.irqs = STATIC_INIT_LIST_HEAD(sim_irq_chip.irqs),
+	.chip_handle = &irq_handle,
+};
+
+/**
+ * @brief Get the sim IRQ chip.
+ * @return The sim IRQ chip.
+ */
+struct irq_chip *arch_get_irq_chip(void)
+{
+	return &sim_irq_chip;
+}
+#endif
+
+int cpu_get_id(void)
+{
+	return 0;
+}
+
+/* @} */
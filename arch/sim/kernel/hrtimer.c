@@ -0,0 +1,50 @@
+/*
+ *  ETA/OS - Sim high resolution timer
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/hrtimer.h>
+#include <etaos/init.h>
+
+#include <asm/timer.h>
+#include <asm/irq.h>
+#include <asm/host.h>
+#include <asm/io.h>
+
+#define SIM_HRTIMER_FREQ 2000
+
+static struct clocksource sim_hrtimer_src = {
+	.name = "sim-hr-clock",
+};
+
+unsigned long arch_hrtimer_cycles(void)
+{
+	return (unsigned long)sim_host_time_ns();
+}
+
+static void __used sim_hrtimer_init(void)
+{
+	clocksource_init(sim_hrtimer_src.name, &sim_hrtimer_src,
+			SIM_HRTIMER_FREQ);
+	sysctl(SYS_SET_HR_CLK, &sim_hrtimer_src);
+	hrtimer_init(SIM_HRTIMER_IRQ, &sim_hrtimer_src);
+	sim_host_irq_timer(SIM_HRTIMER_IRQ, SIM_HRTIMER_FREQ);
+}
+
+subsys_init(sim_hrtimer_init);
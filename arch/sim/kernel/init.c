@@ -0,0 +1,92 @@
+/*
+ *  ETA/OS - Sim boot
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sim
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/vfs.h>
+#include <etaos/device.h>
+#include <etaos/mem.h>
+#include <etaos/init.h>
+
+#include <asm/io.h>
+#include <asm/irq.h>
+#include <asm/init.h>
+#include <asm/host.h>
+
+#ifdef CONFIG_VFS_MODULE
+#define CONFIG_VFS
+#endif
+
+#ifdef CONFIG_DRIVER_CORE_MODULE
+#define CONFIG_DRIVER_CORE
+#endif
+
+#ifdef CONFIG_MALLOC
+static char sim_heap[CONFIG_SIM_HEAP_SIZE];
+#endif
+
+/**
+ * @brief Early system initialisation.
+ *
+ * Runs before all other initialisation functions. It takes the place of
+ * the AVR bootstrap code and the first device init section.
+ */
+static void __used SIM_EARLY_ATTRIB sim_early_init(void)
+{
+#ifdef CONFIG_MALLOC
+	mm_init();
+	raw_mm_heap_add_block(sim_heap, CONFIG_SIM_HEAP_SIZE);
+#endif
+
+#ifdef CONFIG_IRQ_SUPPORT
+	sim_irq_init();
+#endif
+	post_early_init = true;
+
+#ifdef CONFIG_DRIVER_CORE
+#ifdef CONFIG_VFS
+	vfs_init();
+#endif
+	dev_core_init();
+#endif
+}
+
+/**
+ * @brief Start the kernel.
+ *
+ * Called by the host main function once all initialisation functions
+ * have completed.
+ */
+void sim_start(void)
+{
+	post_dev_init = true;
+	kinit();
+	while(1);
+}
+
+void finalize_init(void)
+{
+	post_init = true;
+}
+
+/* @} */
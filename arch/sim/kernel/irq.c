@@ -0,0 +1,110 @@
+/*
+ *  ETA/OS - Sim IRQ management
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sim
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/irq.h>
+#include <etaos/preempt.h>
+
+#include <asm/io.h>
+#include <asm/irq.h>
+#include <asm/host.h>
+
+void arch_irq_disable(void)
+{
+	sim_host_irq_disable();
+}
+
+void arch_irq_enable(void)
+{
+	sim_host_irq_enable();
+}
+
+void arch_local_irq_enable(void)
+{
+	arch_irq_enable();
+}
+
+void arch_local_irq_disable(void)
+{
+	arch_irq_disable();
+}
+
+unsigned long arch_irq_get_flags(void)
+{
+	return (unsigned long)sim_host_irq_enabled();
+}
+
+void arch_irq_restore_flags(unsigned long *flags)
+{
+	if(*flags)
+		sim_host_irq_enable();
+}
+
+void raw_irq_enabled_flags(unsigned long *flags)
+{
+	*flags = (unsigned long)sim_host_irq_enabled();
+}
+
+/**
+ * @brief Handle a host signal.
+ * @param irq IRQ vector number.
+ *
+ * Called by the host with IRQs disabled. External IRQs are preemption
+ * points, just like the external IRQs of the AVR.
+ */
+static void sim_irq_handle(int irq)
+{
+	struct irq_chip *chip = arch_get_irq_chip();
+
+	chip->chip_handle(irq);
+	if(irq == SIM_EXT_IRQ0 || irq == SIM_EXT_IRQ1)
+		preempt_schedule_irq();
+}
+
+/**
+ * @brief Install the host signal handlers.
+ */
+void sim_irq_init(void)
+{
+	sim_host_irq_init(&sim_irq_handle);
+}
+
+void cpu_request_irq(struct irq_data *data)
+{
+	/* The host signals are always routed to the IRQ chip */
+}
+
+#ifdef CONFIG_SOFT_IRQ
+int cpu_trigger_irq(struct irq_data *data)
+{
+	if(data->irq >= SIM_IRQ_NUM)
+		return -EINVAL;
+
+	sim_host_irq_raise(data->irq);
+	return -EOK;
+}
+#endif
+
+/* @} */
@@ -0,0 +1,39 @@
+/*
+ *  ETA/OS - Sim power management
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/power.h>
+
+#include <asm/host.h>
+
+void arch_set_power_mode(int mode)
+{
+	/* The host process has a single sleep mode */
+}
+
+void arch_hibernate(void)
+{
+	sim_host_idle();
+}
+
+void arch_hibernate_irq_enable(void)
+{
+	/* IRQs that arrive while disabled stay pending and end the wait */
+	sim_host_idle();
+	sim_host_irq_enable();
+}
@@ -0,0 +1,153 @@
+/*
+ *  ETA/OS - Sim scheduling core
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/irq.h>
+#include <etaos/mem.h>
+#include <etaos/panic.h>
+
+#include <asm/timer.h>
+#include <asm/sched.h>
+#include <asm/host.h>
+#include <asm/io.h>
+
+#ifndef CONFIG_SQS
+static DEFINE_RQ(sim_rq, &sys_sched_class);
+#endif
+
+#ifdef CONFIG_SQS
+struct rq *cpu_to_rq(int cpu)
+{
+	return sched_get_grq();
+}
+
+struct rq *sched_get_cpu_rq(void)
+{
+	return sched_get_grq();
+}
+
+struct rq *sched_select_rq(void)
+{
+	return sched_get_grq();
+}
+
+#else
+
+struct rq *cpu_to_rq(int cpu)
+{
+	return &sim_rq;
+}
+
+struct rq *sched_get_cpu_rq(void)
+{
+	return &sim_rq;
+}
+
+struct rq *sched_select_rq(void)
+{
+	return &sim_rq;
+}
+#endif
+
+struct clocksource *sched_get_clock(void)
+{
+	return sim_get_sys_clk();
+}
+
+/*
+ * Stack of the main thread. On the AVR this is the stack the system
+ * boots on, which is provided by the linker script.
+ */
+char main_stack_ptr_start[CONFIG_STACK_SIZE];
+
+/*
+ * Threads run on host contexts with their own host stack. The frame at
+ * the top of the ETA/OS stack holds the host context and the thread entry.
+ * Since the thread doesn't run on the ETA/OS stack, stack usage can't be
+ * measured on the sim architecture.
+ */
+struct sim_stack_frame {
+	struct sim_context *ctx;
+	thread_handle_t handle;
+	void *param;
+	unsigned long irq_flags;
+};
+
+static inline struct sim_stack_frame *sim_get_frame(struct thread *tp)
+{
+	return (struct sim_stack_frame*)tp->stack.sp;
+}
+
+static void sim_thread_start(void *arg)
+{
+	struct sim_stack_frame *frame = sim_get_frame(arg);
+
+	/* Threads start with the IRQ state of their creator */
+	if(frame->irq_flags)
+		sim_host_irq_enable();
+	else
+		sim_host_irq_disable();
+
+	frame->handle(frame->param);
+	kill();
+}
+
+void sched_create_stack_frame(struct thread *tp, stack_t *stack,
+				size_t stack_size, thread_handle_t handle)
+{
+	struct sim_stack_frame *frame;
+	struct stack_info *info;
+	size_t host_size;
+
+	if(!stack || !stack_size)
+		return;
+
+	info = &tp->stack;
+	info->base = stack;
+	info->size = stack_size;
+	info->sp = (stack_t*)(((unsigned long)&stack[stack_size] -
+			sizeof(*frame)) & ~(sizeof(void*) - 1));
+	frame = sim_get_frame(tp);
+
+	frame->handle = handle;
+	frame->param = tp->param;
+	frame->irq_flags = sim_host_irq_enabled();
+
+	host_size = stack_size;
+	if(host_size < CONFIG_SIM_HOST_STACK_SIZE)
+		host_size = CONFIG_SIM_HOST_STACK_SIZE;
+
+	frame->ctx = sim_host_context_create(&sim_thread_start, tp, host_size);
+	if(!frame->ctx)
+		panic("Cannot create a host context for %s!\n", tp->name);
+}
+
+void sched_free_stack_frame(struct thread *tp)
+{
+	sim_host_context_destroy(sim_get_frame(tp)->ctx);
+	kfree(tp->stack.base);
+}
+
+void cpu_switch_context(struct rq *rq, struct thread *prev, struct thread *next)
+{
+	sim_host_context_switch(prev ? sim_get_frame(prev)->ctx : NULL,
+			sim_get_frame(next)->ctx);
+}
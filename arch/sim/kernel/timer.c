@@ -0,0 +1,78 @@
+/*
+ *  ETA/OS - Sim timers
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sim
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/tick.h>
+#include <etaos/error.h>
+#include <etaos/time.h>
+#include <etaos/delay.h>
+#include <etaos/init.h>
+
+#include <asm/timer.h>
+#include <asm/irq.h>
+#include <asm/host.h>
+#include <asm/io.h>
+
+/**
+ * @def SIM_SYSCLK_FRQ
+ * @brief Frequency of the sim system clock.
+ */
+#define SIM_SYSCLK_FRQ 1000UL
+
+static struct clocksource sysclk = {
+	.name = "sys-clk",
+};
+
+/**
+ * @brief Getter for the sim system clock.
+ * @return The sim system clock.
+ */
+struct clocksource *sim_get_sys_clk(void)
+{
+	return &sysclk;
+}
+
+/**
+ * @brief Start the system clock.
+ *
+ * The system tick is a periodic host timer, which raises SIM_SYSCLK_IRQ.
+ */
+static void __used sim_timer_init(void)
+{
+	clocksource_init(sysclk.name, &sysclk, SIM_SYSCLK_FRQ);
+	systick_setup(SIM_SYSCLK_IRQ, &sysclk);
+	sim_host_irq_timer(SIM_SYSCLK_IRQ, SIM_SYSCLK_FRQ);
+	sysctl(SYS_SET_SYSCLK, &sysclk);
+}
+
+#ifdef CONFIG_DELAY_US
+void arch_delay_us(unsigned int us)
+{
+	sim_host_delay_us(us);
+}
+#endif
+
+subsys_init(sim_timer_init);
+
+/* @} */
@@ -0,0 +1,101 @@
+/*
+ *  ETA/OS - Sim host contexts
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include <asm/host.h>
+
+struct sim_context {
+	ucontext_t uc;
+	void (*entry)(void *);
+	void *arg;
+	unsigned long size;
+};
+
+#define SIM_CTX_HDR_SIZE ((sizeof(struct sim_context) + 63UL) & ~63UL)
+
+/*
+ * makecontext only passes int arguments, so the context pointer is split
+ * into two halves.
+ */
+static void sim_context_start(unsigned int hi, unsigned int lo)
+{
+	struct sim_context *ctx;
+
+	ctx = (struct sim_context*)((((uintptr_t)hi << 16) << 16) | lo);
+	ctx->entry(ctx->arg);
+}
+
+struct sim_context *sim_host_context_create(void (*entry)(void *),
+		void *arg, unsigned long stack_size)
+{
+	struct sim_context *ctx;
+	unsigned long size;
+	uintptr_t addr;
+
+	size = SIM_CTX_HDR_SIZE + stack_size;
+	ctx = sim_host_map(size);
+	if(!ctx)
+		return NULL;
+
+	if(getcontext(&ctx->uc)) {
+		sim_host_unmap(ctx, size);
+		return NULL;
+	}
+
+	ctx->entry = entry;
+	ctx->arg = arg;
+	ctx->size = size;
+
+	ctx->uc.uc_link = NULL;
+	ctx->uc.uc_stack.ss_sp = (char*)ctx + SIM_CTX_HDR_SIZE;
+	ctx->uc.uc_stack.ss_size = stack_size;
+	ctx->uc.uc_stack.ss_flags = 0;
+
+	/*
+	 * Contexts can be created from a signal handler, in which case the
+	 * current signal mask blocks that signal. IRQ masking is done in
+	 * software, so threads always start with an empty mask.
+	 */
+	sigemptyset(&ctx->uc.uc_sigmask);
+
+	addr = (uintptr_t)ctx;
+	makecontext(&ctx->uc, (void (*)(void))&sim_context_start, 2,
+			(unsigned int)((addr >> 16) >> 16),
+			(unsigned int)(addr & 0xFFFFFFFFUL));
+	return ctx;
+}
+
+void sim_host_context_destroy(struct sim_context *ctx)
+{
+	if(ctx)
+		sim_host_unmap(ctx, ctx->size);
+}
+
+void sim_host_context_switch(struct sim_context *prev,
+		struct sim_context *next)
+{
+	if(prev)
+		swapcontext(&prev->uc, &next->uc);
+	else
+		setcontext(&next->uc);
+}
@@ -0,0 +1,77 @@
+/*
+ *  ETA/OS - Sim host services
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <asm/host.h>
+
+/*
+ * The ETA/OS kernel defines symbols such as read, write and malloc, which
+ * take precedence over those of the host C library. Host services that
+ * clash with a kernel symbol are therefore called through syscall().
+ */
+
+void *sim_host_map(unsigned long size)
+{
+	void *addr;
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return addr == MAP_FAILED ? NULL : addr;
+}
+
+void sim_host_unmap(void *addr, unsigned long size)
+{
+	munmap(addr, size);
+}
+
+long sim_host_write(int fd, const void *buf, unsigned long len)
+{
+	return syscall(SYS_write, fd, buf, len);
+}
+
+long sim_host_read(int fd, void *buf, unsigned long len)
+{
+	return syscall(SYS_read, fd, buf, len);
+}
+
+unsigned long long sim_host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void sim_host_delay_us(unsigned int us)
+{
+	unsigned long long end;
+
+	end = sim_host_time_ns() + us * 1000ULL;
+	while(sim_host_time_ns() < end);
+}
+
+void sim_host_exit(int code)
+{
+	syscall(SYS_exit_group, code);
+}
@@ -0,0 +1,162 @@
+/*
+ *  ETA/OS - Sim host signals
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <asm/host.h>
+
+/*
+ * IRQs are host signals. Signals are never blocked on the host, instead
+ * the kernel masks IRQs using a software flag. A signal that arrives while
+ * IRQs are disabled is marked pending and handled as soon as IRQs are
+ * enabled again.
+ */
+
+static volatile int sim_irq_flag;
+static volatile unsigned long sim_irq_pending;
+static sim_irq_handler_t sim_irq_handler;
+
+static void sim_irq_dispatch(void)
+{
+	unsigned long pending;
+	int irq;
+
+	while(__atomic_load_n(&sim_irq_pending, __ATOMIC_SEQ_CST)) {
+		/* Claim the IRQ flag, it might have been claimed by a signal */
+		if(!__atomic_exchange_n(&sim_irq_flag, 0, __ATOMIC_SEQ_CST))
+			return;
+
+		pending = __atomic_load_n(&sim_irq_pending, __ATOMIC_SEQ_CST);
+		if(pending) {
+			irq = __builtin_ctzl(pending);
+			__atomic_fetch_and(&sim_irq_pending, ~(1UL << irq),
+					__ATOMIC_SEQ_CST);
+			sim_irq_handler(irq);
+		}
+
+		__atomic_store_n(&sim_irq_flag, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void sim_irq_signal(int sig, siginfo_t *info, void *uc)
+{
+	int irq;
+
+	switch(sig) {
+	case SIGUSR1:
+		irq = SIM_EXT_IRQ0;
+		break;
+
+	case SIGUSR2:
+		irq = SIM_EXT_IRQ1;
+		break;
+
+	default:
+		irq = info->si_value.sival_int;
+		break;
+	}
+
+	sim_host_irq_raise(irq);
+}
+
+void sim_host_irq_init(sim_irq_handler_t handler)
+{
+	struct sigaction sa;
+
+	sim_irq_handler = handler;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = &sim_irq_signal;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	sigaction(SIGALRM, &sa, NULL);
+	sigaction(SIGUSR1, &sa, NULL);
+	sigaction(SIGUSR2, &sa, NULL);
+}
+
+int sim_host_irq_timer(int irq, unsigned long freq)
+{
+	struct sigevent sev;
+	struct itimerspec its;
+	int timer;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGALRM;
+	sev.sigev_value.sival_int = irq;
+
+	/*
+	 * The kernel defines timer_create, so the host timer is created
+	 * using the system call.
+	 */
+	if(syscall(SYS_timer_create, CLOCK_MONOTONIC, &sev, &timer))
+		return -1;
+
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = 1000000000L / freq;
+	its.it_value = its.it_interval;
+	return syscall(SYS_timer_settime, timer, 0, &its, NULL);
+}
+
+/*
+ * Raise an IRQ from software. It is handled immediately, unless IRQs are
+ * disabled.
+ */
+void sim_host_irq_raise(int irq)
+{
+	__atomic_fetch_or(&sim_irq_pending, 1UL << irq, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&sim_irq_flag, __ATOMIC_SEQ_CST))
+		sim_irq_dispatch();
+}
+
+void sim_host_irq_disable(void)
+{
+	__atomic_store_n(&sim_irq_flag, 0, __ATOMIC_SEQ_CST);
+}
+
+void sim_host_irq_enable(void)
+{
+	__atomic_store_n(&sim_irq_flag, 1, __ATOMIC_SEQ_CST);
+	sim_irq_dispatch();
+}
+
+int sim_host_irq_enabled(void)
+{
+	return __atomic_load_n(&sim_irq_flag, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Wait for the next signal. IRQs that are pending are handled first, so
+ * the caller can't sleep through an IRQ that is already due.
+ */
+void sim_host_idle(void)
+{
+	sigset_t set;
+
+	if(__atomic_load_n(&sim_irq_pending, __ATOMIC_SEQ_CST))
+		return;
+
+	sigemptyset(&set);
+	sigsuspend(&set);
+}
@@ -0,0 +1,30 @@
+/*
+ *  ETA/OS - Sim host entry point
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <asm/host.h>
+
+/*
+ * The ETA/OS initialisation functions are constructors, so they have all
+ * run by now. The application main function has been renamed to
+ * etaos_main and is called by the kernel.
+ */
+int main(int argc, char **argv)
+{
+	sim_start();
+	return 0;
+}
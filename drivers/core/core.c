@@ -231,9 +231,9 @@ int dev_set_fops(struct device *dev, struct dev_file_ops *fops)
 	if(!dev)
 		return -EINVAL;
 
-	mutex_lock(&dev->dev_lock);
+	mutex_lock_pi(&dev->dev_lock);
 	_dev_set_fops(dev, fops);
-	mutex_unlock(&dev->dev_lock);
+	mutex_unlock_pi(&dev->dev_lock);
 	return -EOK;
 }
 
@@ -244,7 +244,7 @@ int dev_set_fops(struct device *dev, struct dev_file_ops *fops)
  */
 void dev_lock(struct device *dev)
 {
-	mutex_lock(&dev->dev_lock);
+	mutex_lock_pi(&dev->dev_lock);
 }
 
 /**
@@ -253,7 +253,7 @@ void dev_lock(struct device *dev)
  */
 void dev_unlock(struct device *dev)
 {
-	mutex_unlock(&dev->dev_lock);
+	mutex_unlock_pi(&dev->dev_lock);
 }
 #endif
 
@@ -77,9 +77,9 @@ int i2c_bus_xfer(struct i2c_bus *bus,
 {
 	int ret;
 
-	mutex_lock(&bus->lock);
+	mutex_lock_pi(&bus->lock);
 	ret = __i2c_transfer(bus, msgs, len);
-	mutex_unlock(&bus->lock);
+	mutex_unlock_pi(&bus->lock);
 
 	return (ret == -EOK) ? len : ret;
 }
@@ -99,9 +99,9 @@ int i2c_set_bus_speed(struct i2c_bus *bus, uint32_t bps)
 	if(!bus || !bps)
 		return -EINVAL;
 
-	mutex_lock(&bus->lock);
+	mutex_lock_pi(&bus->lock);
 	ret = bus->ctrl(bus, I2C_SET_SPEED, &bps);
-	mutex_unlock(&bus->lock);
+	mutex_unlock_pi(&bus->lock);
 
 	return ret;
 }
@@ -52,9 +52,9 @@
 #define SPI_TMO 500
 #define SPI_RETRIES 3
 
-static mutex_t master_xfer_mutex;
+static struct spi_driver atmega_spi_driver;
 static uint8_t *master_rx_buff;
-static uint8_t *master_tx_buff;
+static const uint8_t *master_tx_buff;
 static size_t   master_index;
 static size_t   master_length;
 
@@ -75,10 +75,11 @@ static irqreturn_t atmega_spi_stc_irq(struct irq_data *irq, void *data)
 		master_rx_buff[master_index - 1] = SPDR;
 
 	if(master_index < master_length) {
-		SPDR = master_tx_buff[master_index];
+		SPDR = master_tx_buff ? master_tx_buff[master_index] : 0xFF;
 		master_index += 1;
 	} else {
-		mutex_unlock_from_irq(&master_xfer_mutex);
+		SPCR &= ~SPIE;
+		spi_xfer_complete(&atmega_spi_driver, master_length);
 	}
 
 	return IRQ_HANDLED;
@@ -162,6 +163,13 @@ static int atmega_spi_control(struct spidev *dev, spi_ctrl_t ctrl, void *data)
 	case SPI_2X:
 		SPSR ^= SPI2X;
 		break;
+
+	case SPI_ABORT:
+		SPCR &= ~SPIE;
+		/* reading SPSR followed by SPDR clears SPIF */
+		(void)SPSR;
+		(void)SPDR;
+		break;
 	
 	default:
 		rv = -EINVAL;
@@ -171,16 +179,46 @@ static int atmega_spi_control(struct spidev *dev, spi_ctrl_t ctrl, void *data)
 	return rv;
 }
 
-#define ATMEGA_SPI_TMO 500
+/**
+ * @brief Transfer a message by polling the bus.
+ * @param msg Message to transfer.
+ * @return Amount of bytes transferred.
+ *
+ * For short messages the IRQ overhead is larger than the time it takes to
+ * transfer a byte, so it is cheaper to wait for the bus.
+ */
+static int atmega_spi_poll(struct spi_msg *msg)
+{
+	uint8_t *rx = msg->rx;
+	const uint8_t *tx = msg->tx;
+	uint8_t c;
+	size_t idx;
+
+	for(idx = 0; idx < msg->len; idx++) {
+		SPDR = tx ? tx[idx] : 0xFF;
+		while(!(SPSR & SPIF));
+
+		c = SPDR;
+		if(rx)
+			rx[idx] = c;
+	}
+
+	return msg->len;
+}
 
 /**
  * @brief Start a transmission over the ATmega SPI bus.
  * @param dev Device in control of the transfer.
  * @param msg Message to transfer.
- * @return Amount of bytes transferred.
+ * @param poll Whether \p msg may be transferred by polling the bus.
+ * @return An error code or the amount of bytes transferred.
+ * @see spi_driver::start
  */
-static int atmega_spi_xfer(struct spidev *dev, struct spi_msg *msg)
+static int atmega_spi_start(struct spidev *dev, struct spi_msg *msg, bool poll)
 {
+	if(poll && msg->len <= CONFIG_SPI_POLL_LENGTH)
+		return atmega_spi_poll(msg);
+
 	master_rx_buff = msg->rx;
 	master_tx_buff = msg->tx;
 	master_length = msg->len;
@@ -190,14 +228,9 @@ static int atmega_spi_xfer(struct spidev *dev, struct spi_msg *msg)
 	master_index = 1;
 
 	SPCR |= SPIE;
-	SPDR = master_tx_buff[0];
+	SPDR = master_tx_buff ? master_tx_buff[0] : 0xFF;
 
-	if(mutex_wait_tmo(&master_xfer_mutex, ATMEGA_SPI_TMO))
-		return -EAGAIN;
-
-	SPCR &= ~SPIE;
-
-	return msg->len;
+	return -EOK;
 }
 
 static struct spi_driver atmega_spi_driver = {
@@ -205,7 +238,7 @@ static struct spi_driver atmega_spi_driver = {
 	.retries = SPI_RETRIES,
 	.timeout = SPI_TMO,
 	.ctrl = &atmega_spi_control,
-	.transfer = &atmega_spi_xfer,
+	.start = &atmega_spi_start,
 };
 
 static void __used atmega_spi_init(void)
@@ -214,7 +247,6 @@ static void __used atmega_spi_init(void)
 	struct gpio_pin *cs;
 
 	/* software initialisation */
-	mutex_init(&master_xfer_mutex);
 	mutex_init(&atmega_spi_driver.lock);
 	master_rx_buff = NULL;
 	master_tx_buff = NULL;
@@ -28,15 +28,119 @@
 #include <etaos/spi.h>
 #include <etaos/bitops.h>
 #include <etaos/init.h>
+#include <etaos/gpio.h>
+#include <etaos/mempool.h>
+#include <etaos/event.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/irq.h>
 #include <etaos/time.h>
 #include <etaos/tick.h>
-#include <etaos/gpio.h>
 
 /**
  * @brief SPI system bus
  */
 struct spi_driver *spi_sysbus;
 
+#ifdef CONFIG_SPI_MSG_POOL
+/**
+ * @brief SPI message pool.
+ * @see spi_alloc_msg
+ */
+DEFINE_MEM_POOL(spi_msg_pool, sizeof(struct spi_msg), CONFIG_SPI_MSG_POOL_SIZE);
+#endif
+
+static void spi_xfer_run(struct spi_driver *master, bool poll);
+
+/**
+ * @brief Drive the chip select line of a device.
+ * @param dev Device to (de)select.
+ * @param active Whether to select \p dev or not.
+ * @note The CS pin is requested when the device is added to the bus.
+ */
+static inline void spi_cs_write(struct spidev *dev, bool active)
+{
+	if(test_bit(SPI_CS_HIGH_FLAG, &dev->flags))
+		__raw_gpio_pin_write(dev->cs, active);
+	else
+		__raw_gpio_pin_write(dev->cs, !active);
+}
+
+/**
+ * @brief Take the next batch from the transfer queue.
+ * @param master SPI bus.
+ * @return The next batch or \p NULL if the queue is empty or the bus
+ *         is paused.
+ * @note The queue lock must be held.
+ */
+static struct spi_msg *raw_spi_next_batch(struct spi_driver *master)
+{
+	struct spi_msg *msg = NULL;
+
+	if(!master->paused && !list_empty(&master->queue)) {
+		msg = list_entry(master->queue.next, struct spi_msg, entry);
+		list_del(&msg->entry);
+	}
+
+	master->cur = msg;
+	master->xfer = msg;
+	return msg;
+}
+
+/**
+ * @brief Pause a bus and wait until it is idle.
+ * @param master Bus to pause.
+ * @note Bus settings should only be changed when the bus is paused.
+ * @note Don't call this function with spi_driver::lock held, it sleeps.
+ * @see spi_bus_resume
+ *
+ * The batch that is being transferred is allowed to finish. Batches
+ * submitted while the bus is paused are queued, but not started. Only one
+ * thread can pause a bus at a time, others sleep until it is resumed.
+ */
+static void spi_bus_pause(struct spi_driver *master)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&master->qlock, flags);
+	while(master->paused) {
+		raw_spin_unlock_irqrestore(&master->qlock, flags);
+		raw_event_wait(&master->pause_wq, EVENT_WAIT_INFINITE);
+		raw_spin_lock_irqsave(&master->qlock, flags);
+	}
+
+	master->paused = true;
+	while(master->cur) {
+		raw_spin_unlock_irqrestore(&master->qlock, flags);
+		raw_event_wait(&master->idle_wq, EVENT_WAIT_INFINITE);
+		raw_spin_lock_irqsave(&master->qlock, flags);
+	}
+	raw_spin_unlock_irqrestore(&master->qlock, flags);
+}
+
+/**
+ * @brief Resume a paused bus.
+ * @param master Bus to resume.
+ * @see spi_bus_pause
+ */
+static void spi_bus_resume(struct spi_driver *master)
+{
+	struct spi_msg *next;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&master->qlock, flags);
+	master->paused = false;
+	next = raw_spi_next_batch(master);
+	raw_spin_unlock_irqrestore(&master->qlock, flags);
+
+	if(next) {
+		spi_cs_write(next->dev, true);
+		spi_xfer_run(master, true);
+	}
+
+	event_notify(&master->pause_wq);
+}
+
 /**
  * @brief Change the SPI bus mode.
  * @param dev Device requesting the mode change.
@@ -52,7 +156,8 @@ int spi_set_mode(struct spidev *dev, spi_ctrl_t mode)
 		return -EINVAL;
 
 	driver = dev->master;
-	mutex_lock(&driver->lock);
+	spi_bus_pause(driver);
+	mutex_lock_pi(&driver->lock);
 
 	dev->flags &= ~SPI_MODE0_MASK & 0x3;
 	switch(mode) {
@@ -74,66 +179,250 @@ int spi_set_mode(struct spidev *dev, spi_ctrl_t mode)
 	}
 	
 	rv = driver->ctrl(dev, mode, NULL);
-	mutex_unlock(&driver->lock);
+	mutex_unlock_pi(&driver->lock);
+	spi_bus_resume(driver);
 
 	return rv;
 }
 
 /**
- * @brief SPI core backend for SPI transmissions.
- * @param dev Device in control of the transmission.
- * @param msg Message which is to be transferred.
- * @return Error code or the amount of bytes transferred.
+ * @brief Finish the message being transferred.
+ * @param master SPI bus.
+ * @param rv Result of the transfer.
+ * @return True if there is another message to transfer.
+ *
+ * Completes the batch when \p rv is an error or when the message was the
+ * last of its batch. In that case the next batch in the queue is started,
+ * or the thread pausing the bus is woken up.
  */
-static int __spi_xfer(struct spidev *dev, struct spi_msg *msg)
+static bool spi_xfer_finish(struct spi_driver *master, int rv)
 {
-	int rv;
-	char retries;
-	tick_t click, ref = sys_tick;
-	struct spi_driver *master = dev->master;
+	struct spi_msg *batch, *msg, *next;
+	unsigned long flags;
+	bool paused;
 
-	gpio_pin_request(dev->cs);
-	if(test_bit(SPI_CS_HIGH_FLAG, &dev->flags))
-		gpio_pin_write(dev->cs, 1);
+	batch = master->cur;
+	msg = master->xfer;
+
+	if(rv < 0)
+		batch->status = rv;
 	else
-		gpio_pin_write(dev->cs, 0);
+		batch->status += rv;
 
-	for(retries = 0, rv = 0; retries < master->retries; retries++) {
-		rv = master->transfer(dev, msg);
+	if(rv >= 0 && msg->next) {
+		master->xfer = msg->next;
+		return true;
+	}
 
-		if(rv != -EAGAIN)
-			break;
+	spi_cs_write(batch->dev, false);
 
-		click = sys_tick;
-		if(time_after(click, ref+master->timeout))
-			break;
+	raw_spin_lock_irqsave(&master->qlock, flags);
+	next = raw_spi_next_batch(master);
+	paused = master->paused;
+	raw_spin_unlock_irqrestore(&master->qlock, flags);
+
+	if(batch->complete)
+		batch->complete(batch, batch->arg);
+
+	if(next)
+		spi_cs_write(next->dev, true);
+	else if(paused)
+		event_notify(&master->idle_wq);
+
+	return next != NULL;
+}
+
+/**
+ * @brief Transfer queued messages until the bus driver has to wait for
+ *        an IRQ or the queue is empty.
+ * @param master SPI bus.
+ * @param poll Whether the bus driver is allowed to poll the bus.
+ * @note Don't poll from IRQ context, a polled transfer completes the next
+ *       message in the same call and could drain the entire queue.
+ */
+static void spi_xfer_run(struct spi_driver *master, bool poll)
+{
+	struct spi_msg *msg;
+	char retries;
+	tick_t ref;
+	int rv;
+
+	do {
+		msg = master->xfer;
+		if(!msg->len) {
+			rv = 0;
+			continue;
+		}
+
+		ref = sys_tick;
+		retries = 0;
+		do {
+			rv = master->start(master->cur->dev, msg, poll);
+		} while(rv == -EAGAIN && ++retries < master->retries &&
+				!time_after(sys_tick, ref + master->timeout));
+
+		if(rv == -EOK)
+			return;
+	} while(spi_xfer_finish(master, rv));
+}
+
+/**
+ * @brief Signal the completion of a transfer.
+ * @param master SPI bus that completed the transfer.
+ * @param rv Amount of bytes transferred or an error code.
+ * @note Called by SPI bus drivers, usually from IRQ context.
+ * @see spi_driver::start
+ */
+void spi_xfer_complete(struct spi_driver *master, int rv)
+{
+	if(spi_xfer_finish(master, rv))
+		spi_xfer_run(master, false);
+}
+
+/**
+ * @brief Cancel a batch that didn't complete in time.
+ * @param master SPI bus.
+ * @param batch Batch to cancel.
+ * @return True if \p batch has been cancelled, false if it is completing.
+ *
+ * A batch that is still queued is removed from the queue. When \p batch is
+ * being transferred, the bus driver is told to abort the transfer and the
+ * next batch is started.
+ */
+static bool spi_xfer_cancel(struct spi_driver *master, struct spi_msg *batch)
+{
+	struct spi_msg *next;
+	unsigned long flags;
+	bool paused;
+
+	raw_spin_lock_irqsave(&master->qlock, flags);
+	if(batch->entry.next) {
+		list_del(&batch->entry);
+		raw_spin_unlock_irqrestore(&master->qlock, flags);
+		return true;
 	}
 
-	if(test_bit(SPI_CS_HIGH_FLAG, &dev->flags))
-		gpio_pin_write(dev->cs, 0);
-	else
-		gpio_pin_write(dev->cs, 1);
+	if(master->cur != batch) {
+		raw_spin_unlock_irqrestore(&master->qlock, flags);
+		return false;
+	}
 
-	gpio_pin_release(dev->cs);
+	master->ctrl(batch->dev, SPI_ABORT, NULL);
+	spi_cs_write(batch->dev, false);
+	next = raw_spi_next_batch(master);
+	paused = master->paused;
+	raw_spin_unlock_irqrestore(&master->qlock, flags);
+
+	if(next) {
+		spi_cs_write(next->dev, true);
+		spi_xfer_run(master, true);
+	} else if(paused) {
+		event_notify(&master->idle_wq);
+	}
 
-	return rv;
+	return true;
+}
+
+/**
+ * @brief Queue an SPI message (batch) for transfer.
+ * @param dev Device to transfer \p msg to.
+ * @param msg Message to transfer.
+ * @param complete Completion callback.
+ * @param arg Argument to \p complete.
+ * @return An error code.
+ *
+ * The messages chained using spi_msg::next are transferred back to back,
+ * without releasing the chip select line. The messages and their buffers
+ * should remain valid until \p complete has been called. The result of the
+ * transfer is stored in spi_msg::status of \p msg.
+ *
+ * @note \p complete might be called from IRQ context, or before spi_submit
+ *       returns.
+ */
+int spi_submit(struct spidev *dev, struct spi_msg *msg,
+		spi_complete_t complete, void *arg)
+{
+	struct spi_driver *master;
+	struct spi_msg *next;
+	unsigned long flags;
+
+	if(!dev || !msg)
+		return -EINVAL;
+
+	master = dev->master;
+	msg->dev = dev;
+	msg->complete = complete;
+	msg->arg = arg;
+	msg->status = 0;
+
+	raw_spin_lock_irqsave(&master->qlock, flags);
+	list_add_tail(&msg->entry, &master->queue);
+	next = master->cur ? NULL : raw_spi_next_batch(master);
+	raw_spin_unlock_irqrestore(&master->qlock, flags);
+
+	if(next) {
+		spi_cs_write(next->dev, true);
+		spi_xfer_run(master, true);
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Synchronous transfer data.
+ */
+struct spi_sync {
+	struct thread_queue qp; //!< Queue to wait for completion in.
+	volatile bool done; //!< Completion flag.
+};
+
+static void spi_sync_complete(struct spi_msg *msg, void *arg)
+{
+	struct spi_sync *sync = arg;
+	unsigned long flags;
+
+	/*
+	 * The waiter owns sync and returns as soon as it sees the done flag.
+	 * Don't let it run before the notification has been delivered.
+	 */
+	irq_save_and_disable(&flags);
+	sync->done = true;
+	event_notify(&sync->qp);
+	irq_restore(&flags);
 }
 
 /**
  * @brief Transfer an SPI message.
  * @param dev Device requesting the transmission.
  * @param msg Message to transfer.
- * @return Amount of bytes transferred.
+ * @return Amount of bytes transferred or an error code.
+ * @retval -ETIMEDOUT if \p msg wasn't transferred within
+ *                    spi_driver::timeout miliseconds.
+ *
+ * Queues \p msg and waits until it has been transferred.
  */
 int spi_transfer(struct spidev *dev, struct spi_msg *msg)
 {
+	struct spi_sync sync;
 	int rv;
 
-	mutex_lock(&dev->master->lock);
-	rv = __spi_xfer(dev, msg);
-	mutex_unlock(&dev->master->lock);
+	thread_queue_init(&sync.qp);
+	sync.qp.qhead = NULL;
+	sync.done = false;
 
-	return rv;
+	rv = spi_submit(dev, msg, &spi_sync_complete, &sync);
+	if(rv)
+		return rv;
+
+	while(!sync.done) {
+		if(raw_event_wait(&sync.qp, dev->master->timeout) &&
+				spi_xfer_cancel(dev->master, msg)) {
+			msg->status = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	return msg->status;
 }
 
 /**
@@ -151,7 +440,8 @@ int spi_enable_2x(struct spidev *dev)
 		return -EINVAL;
 	master = dev->master;
 
-	mutex_lock(&master->lock);
+	spi_bus_pause(master);
+	mutex_lock_pi(&master->lock);
 	ret = master->ctrl(dev, SPI_2X, NULL);
 	
 	if(!ret) {
@@ -160,7 +450,8 @@ int spi_enable_2x(struct spidev *dev)
 		else
 			set_bit(SPI_2X_FLAG, &dev->flags);
 	}
-	mutex_unlock(&master->lock);
+	mutex_unlock_pi(&master->lock);
+	spi_bus_resume(master);
 
 	return ret;
 }
@@ -181,9 +472,11 @@ int spi_set_speed(struct spidev *dev, uint32_t bps)
 
 	driver = dev->master;
 
-	mutex_lock(&driver->lock);
+	spi_bus_pause(driver);
+	mutex_lock_pi(&driver->lock);
 	ret = driver->ctrl(dev, SPI_SET_SPEED, &bps);
-	mutex_unlock(&driver->lock);
+	mutex_unlock_pi(&driver->lock);
+	spi_bus_resume(driver);
 
 	return ret;
 }
@@ -199,6 +492,13 @@ int spi_bus_init(struct spi_driver *driver)
 		return -EINVAL;
 
 	list_head_init(&driver->devices);
+	list_head_init(&driver->queue);
+	spinlock_init(&driver->qlock);
+	driver->cur = NULL;
+	driver->xfer = NULL;
+	driver->paused = false;
+	thread_queue_init(&driver->pause_wq);
+	thread_queue_init(&driver->idle_wq);
 	return -EOK;
 }
 
@@ -206,12 +506,14 @@ int spi_bus_init(struct spi_driver *driver)
  * @brief Add a new SPI device to an existing SPI bus.
  * @param driver SPI bus to add \p dev to.
  * @param dev SPI device which needs a master bus.
+ * @note The chip select pin of \p dev stays requested by the SPI core.
  */
 void spi_add_device(struct spi_driver *driver, struct spidev *dev)
 {
 	if(!driver || !dev)
 		return;
 
+	gpio_pin_request(dev->cs);
 	list_add(&dev->list, &driver->devices);
 	dev->master = driver;
 }
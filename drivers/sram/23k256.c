@@ -54,8 +54,8 @@
 
 static int __sram_put(struct sram *ram, int c);
 static int __sram_get(struct sram *ram);
-static int __sram_write(struct sram *ram, const void *_buff, size_t len);
-static int __sram_read(struct sram *sram, void *_buff, size_t len);
+static int __sram_write(struct sram *ram, const void *buff, size_t len);
+static int __sram_read(struct sram *sram, void *buff, size_t len);
 
 static struct spidev sram_23k256_dev = {
 	.flags = 0UL,
@@ -78,71 +78,69 @@ static struct sram sram_23k256_chip = {
 static void sram_set_mode(unsigned short mode)
 {
 	unsigned char buff[2];
-	struct spi_msg *msg;
+	struct spi_msg msg;
 
 	buff[0] = WRSR;
 	buff[1] = mode & 0xFF;
-	msg = spi_alloc_msg(buff, buff, 2);
+	spi_msg_init(&msg, NULL, buff, 2);
 
 	spi_set_speed(&sram_23k256_dev, CONFIG_23K256_SPEED);
 	spi_set_mode(&sram_23k256_dev, SPI_MODE0);
 
-	spi_transfer(&sram_23k256_dev, msg);
-	spi_free_msg(msg);
+	spi_transfer(&sram_23k256_dev, &msg);
 }
 
 /**
- * @brief Write a single byte.
- * @param ram SRAM chip descriptor.
- * @param c Character to write.
- * @return Error code or the amount of bytes written.
+ * @brief Transfer data from or to the 23K256.
+ * @param cmd Instruction (RDDA or WRDA).
+ * @param addr Address to start at.
+ * @param tx Data to write, or \p NULL.
+ * @param rx Buffer to read into, or \p NULL.
+ * @param len Amount of bytes to transfer.
+ * @return Error code or the amount of bytes transferred.
+ *
+ * The instruction header and the data are sent as two segments of a single
+ * SPI batch. The data is transferred from and to the buffer of the caller.
  */
-static int __sram_put(struct sram *ram, int c)
+static int sram_xfer(uint8_t cmd, uint16_t addr, const void *tx, void *rx,
+		size_t len)
 {
+	uint8_t hdr[3];
+	struct spi_msg msg, data;
 	int rv;
-	struct spi_msg *msg;
-	unsigned char byte = c;
-	uint8_t write_seq[] = {
-		WRDA, (uint8_t)((ram->file->index >> 8) & 0xFF),
-		(uint8_t)(ram->file->index & 0xFF), byte
-	};
 
-	msg = spi_alloc_msg(write_seq, write_seq, 4);
+	hdr[0] = cmd;
+	hdr[1] = (uint8_t)((addr >> 8) & 0xFF);
+	hdr[2] = (uint8_t)(addr & 0xFF);
+
+	spi_msg_init(&msg, NULL, hdr, sizeof(hdr));
+	spi_msg_init(&data, rx, tx, len);
+	msg.next = &data;
 
 	dev_sync_lock(&sram_23k256_dev.dev, SRAM_SYNC);
-	sram_set_mode(SPI_BYTE_MODE);
-	rv = spi_transfer(&sram_23k256_dev, msg);
+	sram_set_mode(len > 1 ? SPI_SEQ_MODE : SPI_BYTE_MODE);
+	rv = spi_transfer(&sram_23k256_dev, &msg);
 	dev_sync_unlock(&sram_23k256_dev.dev);
-	spi_free_msg(msg);
 
-	return rv;
+	return rv < 0 ? rv : (int)len;
 }
 
-static int __sram_write(struct sram *ram, const void *_buff, size_t len)
+/**
+ * @brief Write a single byte.
+ * @param ram SRAM chip descriptor.
+ * @param c Character to write.
+ * @return Error code or the amount of bytes written.
+ */
+static int __sram_put(struct sram *ram, int c)
 {
-	struct spi_msg *msg;
-	uint8_t *buff;
-	int rv = -EINVAL;
-
-	buff = kzalloc(len+3);
-	if(!buff)
-		return -ENOMEM;
-
-	memcpy(&buff[3], _buff, len);
-	buff[0] = WRDA;
-	buff[1] = (uint8_t)((ram->file->index >> 8) & 0xFF);
-	buff[2] = (uint8_t)(ram->file->index & 0xFF);
-	msg = spi_alloc_msg(buff, buff, len+3);
+	uint8_t byte = c;
 
-	dev_sync_lock(&sram_23k256_dev.dev, SRAM_SYNC);
-	sram_set_mode(SPI_SEQ_MODE);
-	rv = spi_transfer(&sram_23k256_dev, msg);
-	dev_sync_unlock(&sram_23k256_dev.dev);
-	spi_free_msg(msg);
-
-	kfree(buff);
+	return sram_xfer(WRDA, ram->file->index, &byte, NULL, 1);
+}
 
-	return rv;
+static int __sram_write(struct sram *ram, const void *buff, size_t len)
+{
+	return sram_xfer(WRDA, ram->file->index, buff, NULL, len);
 }
 
 /**
@@ -152,46 +150,15 @@ static int __sram_write(struct sram *ram, const void *_buff, size_t len)
  */
 static int __sram_get(struct sram *ram)
 {
-	uint8_t read_seq[] = {
-		RDDA, (uint8_t)((ram->file->index >> 8) & 0xFF),
-		(uint8_t)(ram->file->index & 0xFF), 0xFF /* dummy byte */
-	};
-	struct spi_msg *msg = spi_alloc_msg(read_seq, read_seq, 4);
-
-	dev_sync_lock(&sram_23k256_dev.dev, SRAM_SYNC);
-	sram_set_mode(SPI_BYTE_MODE);
-	spi_transfer(&sram_23k256_dev, msg);
-	dev_sync_unlock(&sram_23k256_dev.dev);
-	spi_free_msg(msg);
+	uint8_t byte = 0;
 
-	return read_seq[3];
+	sram_xfer(RDDA, ram->file->index, NULL, &byte, 1);
+	return byte;
 }
 
-static int __sram_read(struct sram *sram, void *_buff, size_t len)
+static int __sram_read(struct sram *sram, void *buff, size_t len)
 {
-	struct spi_msg *msg;
-	uint8_t *buff;
-	int rv = -EINVAL;
-
-	buff = kzalloc(len+3);
-	if(!buff)
-		return -EINVAL;
-
-	buff[0] = RDDA;
-	buff[1] = (uint8_t)((sram->file->index >> 8) & 0xFF);
-	buff[2] = (uint8_t)(sram->file->index & 0xFF);
-	msg = spi_alloc_msg(buff, buff, len+3);
-
-	dev_sync_lock(&sram_23k256_dev.dev, SRAM_SYNC);
-	sram_set_mode(SPI_SEQ_MODE);
-	rv = spi_transfer(&sram_23k256_dev, msg);
-	dev_sync_unlock(&sram_23k256_dev.dev);
-	spi_free_msg(msg);
-
-	memcpy(_buff, &buff[3], len);
-	kfree(buff);
-
-	return rv;
+	return sram_xfer(RDDA, sram->file->index, NULL, buff, len);
 }
 
 /**
@@ -0,0 +1,528 @@
+/*
+ *  ETA/OS - External memory manager
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sram/xmem.c
+ */
+
+/**
+ * @addtogroup xmem
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/bitops.h>
+#include <etaos/string.h>
+#include <etaos/mem.h>
+#include <etaos/mutex.h>
+#include <etaos/device.h>
+#include <etaos/sram.h>
+#include <etaos/xmem.h>
+
+#if CONFIG_XMEM_BLOCK_SIZE & (CONFIG_XMEM_BLOCK_SIZE - 1)
+#error "The XMEM block size should be a power of two"
+#endif
+
+#define XMEM_HDR_SIZE sizeof(uint16_t)
+#define XMEM_BLOCKS_PER_LINE (XMEM_LINE_SIZE / CONFIG_XMEM_BLOCK_SIZE)
+
+static inline xmem_t xmem_line_addr(xmem_t addr)
+{
+	return addr & ~((xmem_t)XMEM_LINE_SIZE - 1);
+}
+
+static inline bool xmem_in_range(struct xmem *xm, xmem_t addr, size_t len)
+{
+	size_t size = xm->blocks * CONFIG_XMEM_BLOCK_SIZE;
+
+	if(addr < xm->base || len > size)
+		return false;
+
+	return addr - xm->base <= size - len;
+}
+
+static inline bool xmem_block_used(struct xmem *xm, size_t idx)
+{
+	return (xm->map[idx / 8] & BIT(idx % 8)) != 0;
+}
+
+static inline bool xmem_block_start(struct xmem *xm, size_t idx)
+{
+	return (xm->starts[idx / 8] & BIT(idx % 8)) != 0;
+}
+
+static void xmem_mark_blocks(struct xmem *xm, size_t idx, size_t num,
+		bool used)
+{
+	for(; num; num--, idx++) {
+		if(used)
+			xm->map[idx / 8] |= BIT(idx % 8);
+		else
+			xm->map[idx / 8] &= ~BIT(idx % 8);
+	}
+}
+
+/**
+ * @brief Find a range of free allocation blocks.
+ * @param xm External memory area.
+ * @param num Number of blocks to find.
+ * @return The first block of the range, or xmem::blocks if there is no
+ *         such range.
+ *
+ * Ranges that fit in a single cache line are never placed across a line
+ * boundary, so small allocations can always be pinned as a whole.
+ */
+static size_t xmem_find_blocks(struct xmem *xm, size_t num)
+{
+	size_t idx, start, run;
+
+	for(idx = 0, start = 0, run = 0; idx < xm->blocks; idx++) {
+		if(xmem_block_used(xm, idx)) {
+			run = 0;
+			continue;
+		}
+
+		if(!run) {
+			if(num <= XMEM_BLOCKS_PER_LINE &&
+				(idx % XMEM_BLOCKS_PER_LINE) + num >
+				XMEM_BLOCKS_PER_LINE)
+				continue;
+
+			start = idx;
+		}
+
+		run++;
+		if(run == num)
+			return start;
+	}
+
+	return xm->blocks;
+}
+
+/**
+ * @brief Transfer data between the SRAM chip and internal memory.
+ * @param xm External memory area.
+ * @param addr SRAM address.
+ * @param tx Data to write, or \p NULL to read.
+ * @param rx Buffer to read into.
+ * @param len Number of bytes to transfer.
+ * @return An error code.
+ */
+static int xmem_xfer(struct xmem *xm, xmem_t addr, const void *tx, void *rx,
+		size_t len)
+{
+	struct sram *ram = xm->ram;
+	int rv;
+
+	dev_lock(xm->dev);
+	ram->file->index = addr;
+	if(tx)
+		rv = ram->write(ram, tx, len);
+	else
+		rv = ram->read(ram, rx, len);
+	dev_unlock(xm->dev);
+
+	return rv < 0 ? rv : -EOK;
+}
+
+static int xmem_writeback(struct xmem *xm, struct xmem_line *line)
+{
+	int rv;
+
+	if(!test_bit(XMEM_LINE_DIRTY, &line->flags))
+		return -EOK;
+
+	rv = xmem_xfer(xm, line->addr, line->data, NULL, XMEM_LINE_SIZE);
+	if(!rv)
+		clear_bit(XMEM_LINE_DIRTY, &line->flags);
+
+	return rv;
+}
+
+static struct xmem_line *xmem_lookup(struct xmem *xm, xmem_t addr)
+{
+	struct xmem_line *line;
+	int idx;
+
+	for(idx = 0; idx < CONFIG_XMEM_CACHE_LINES; idx++) {
+		line = &xm->lines[idx];
+		if(test_bit(XMEM_LINE_VALID, &line->flags) && line->addr == addr)
+			return line;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Load a line into the cache.
+ * @param xm External memory area.
+ * @param addr Address of the line.
+ * @return The cache line or \p NULL when all lines are pinned.
+ *
+ * An unused line is taken if there is one. Otherwise the least recently
+ * used line, that isn't pinned, is written back and replaced.
+ */
+static struct xmem_line *xmem_load(struct xmem *xm, xmem_t addr)
+{
+	struct xmem_line *line, *victim = NULL;
+	int idx;
+
+	for(idx = 0; idx < CONFIG_XMEM_CACHE_LINES; idx++) {
+		line = &xm->lines[idx];
+		if(!test_bit(XMEM_LINE_VALID, &line->flags)) {
+			victim = line;
+			break;
+		}
+
+		if(line->pins)
+			continue;
+
+		if(!victim || (long)(line->stamp - victim->stamp) < 0)
+			victim = line;
+	}
+
+	if(!victim || xmem_writeback(xm, victim))
+		return NULL;
+
+	victim->flags = 0UL;
+	if(xmem_xfer(xm, addr, NULL, victim->data, XMEM_LINE_SIZE))
+		return NULL;
+
+	victim->addr = addr;
+	victim->pins = 0;
+	set_bit(XMEM_LINE_VALID, &victim->flags);
+	return victim;
+}
+
+static inline void xmem_touch(struct xmem *xm, struct xmem_line *line)
+{
+	line->stamp = ++xm->clock;
+}
+
+/**
+ * @brief Access external memory through the cache.
+ * @param xm External memory area.
+ * @param addr Address to start at.
+ * @param tx Data to write, or \p NULL to read.
+ * @param rx Buffer to read into.
+ * @param len Number of bytes to access.
+ * @return An error code.
+ * @note The area lock must be held.
+ *
+ * Whole lines that are not cached are transferred directly, so large
+ * transfers don't flush the cache. The same goes for partial lines when
+ * all cache lines are pinned.
+ */
+static int raw_xmem_access(struct xmem *xm, xmem_t addr, const void *tx,
+		void *rx, size_t len)
+{
+	struct xmem_line *line;
+	const uint8_t *src = tx;
+	uint8_t *dst = rx;
+	size_t offset, num;
+	xmem_t tag;
+	int rv;
+
+	while(len) {
+		tag = xmem_line_addr(addr);
+		offset = addr - tag;
+		num = XMEM_LINE_SIZE - offset;
+		if(num > len)
+			num = len;
+
+		line = xmem_lookup(xm, tag);
+		if(!line && num < XMEM_LINE_SIZE)
+			line = xmem_load(xm, tag);
+
+		if(line) {
+			if(src) {
+				memcpy(line->data + offset, src, num);
+				set_bit(XMEM_LINE_DIRTY, &line->flags);
+			} else {
+				memcpy(dst, line->data + offset, num);
+			}
+
+			xmem_touch(xm, line);
+		} else {
+			rv = xmem_xfer(xm, addr, src, dst, num);
+			if(rv)
+				return rv;
+		}
+
+		addr += num;
+		len -= num;
+		if(src)
+			src += num;
+		else
+			dst += num;
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Initialise an external memory area.
+ * @param xm Area to initialise.
+ * @param name Name of the SRAM device (i.e. "23K256").
+ * @param base First address of the area on the SRAM chip.
+ * @param size Size of the area.
+ * @return An error code.
+ * @note \p base should be aligned to XMEM_LINE_SIZE and \p size should be
+ *       a multiple of XMEM_LINE_SIZE.
+ * @warning The area should not be accessed through the device file of
+ *          the SRAM chip.
+ */
+int xmem_init(struct xmem *xm, const char *name, xmem_t base, size_t size)
+{
+	struct device *dev;
+	int idx;
+
+	if(!xm || !name || base % XMEM_LINE_SIZE || size % XMEM_LINE_SIZE)
+		return -EINVAL;
+
+	dev = dev_get_by_name(name);
+	if(!dev || !dev->dev_data)
+		return -EINVAL;
+
+	xm->blocks = size / CONFIG_XMEM_BLOCK_SIZE;
+	if(!xm->blocks)
+		return -EINVAL;
+
+	xm->map = kzalloc((xm->blocks + 7) / 8);
+	if(!xm->map)
+		return -ENOMEM;
+
+	xm->starts = kzalloc((xm->blocks + 7) / 8);
+	if(!xm->starts) {
+		kfree(xm->map);
+		return -ENOMEM;
+	}
+
+	xm->dev = dev;
+	xm->ram = dev->dev_data;
+	xm->base = base;
+	xm->clock = 0UL;
+	mutex_init(&xm->lock);
+
+	for(idx = 0; idx < CONFIG_XMEM_CACHE_LINES; idx++) {
+		xm->lines[idx].flags = 0UL;
+		xm->lines[idx].pins = 0;
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Allocate external memory.
+ * @param xm Area to allocate from.
+ * @param size Number of bytes to allocate.
+ * @return A handle to the allocated memory or XMEM_NULL.
+ */
+xmem_t xmem_alloc(struct xmem *xm, size_t size)
+{
+	xmem_t addr, handle = XMEM_NULL;
+	size_t num, idx;
+	uint16_t hdr;
+
+	if(!size || size > xm->blocks * CONFIG_XMEM_BLOCK_SIZE)
+		return XMEM_NULL;
+
+	num = (size + XMEM_HDR_SIZE + CONFIG_XMEM_BLOCK_SIZE - 1) /
+		CONFIG_XMEM_BLOCK_SIZE;
+
+	mutex_lock(&xm->lock);
+	idx = xmem_find_blocks(xm, num);
+	if(idx < xm->blocks) {
+		hdr = num;
+		addr = xm->base + idx * CONFIG_XMEM_BLOCK_SIZE;
+
+		if(!raw_xmem_access(xm, addr, &hdr, NULL, sizeof(hdr))) {
+			xmem_mark_blocks(xm, idx, num, true);
+			xm->starts[idx / 8] |= BIT(idx % 8);
+			handle = addr + XMEM_HDR_SIZE;
+		}
+	}
+	mutex_unlock(&xm->lock);
+
+	return handle;
+}
+
+/**
+ * @brief Free external memory.
+ * @param xm Area to return the memory to.
+ * @param handle Memory to free.
+ *
+ * Handles that weren't returned by xmem_alloc, or that have already been
+ * freed, are ignored. Only blocks that start an allocation are accepted,
+ * so an address inside a live allocation doesn't free part of it.
+ */
+void xmem_free(struct xmem *xm, xmem_t handle)
+{
+	xmem_t addr;
+	uint16_t hdr;
+	size_t idx;
+
+	if(handle == XMEM_NULL)
+		return;
+
+	addr = handle - XMEM_HDR_SIZE;
+	if(!xmem_in_range(xm, addr, XMEM_HDR_SIZE) ||
+			(addr - xm->base) % CONFIG_XMEM_BLOCK_SIZE)
+		return;
+
+	idx = (addr - xm->base) / CONFIG_XMEM_BLOCK_SIZE;
+	mutex_lock(&xm->lock);
+	if(xmem_block_start(xm, idx) &&
+			!raw_xmem_access(xm, addr, NULL, &hdr, sizeof(hdr))) {
+		if(hdr && idx + hdr <= xm->blocks) {
+			xmem_mark_blocks(xm, idx, hdr, false);
+			xm->starts[idx / 8] &= ~BIT(idx % 8);
+		}
+	}
+	mutex_unlock(&xm->lock);
+}
+
+/**
+ * @brief Read external memory.
+ * @param xm Area to read from.
+ * @param addr Address to start reading at (i.e. a handle).
+ * @param buff Buffer to read into.
+ * @param len Number of bytes to read.
+ * @return An error code.
+ */
+int xmem_read(struct xmem *xm, xmem_t addr, void *buff, size_t len)
+{
+	int rv;
+
+	if(!buff || !xmem_in_range(xm, addr, len))
+		return -EINVAL;
+
+	mutex_lock(&xm->lock);
+	rv = raw_xmem_access(xm, addr, NULL, buff, len);
+	mutex_unlock(&xm->lock);
+
+	return rv;
+}
+
+/**
+ * @brief Write external memory.
+ * @param xm Area to write to.
+ * @param addr Address to start writing at (i.e. a handle).
+ * @param buff Data to write.
+ * @param len Number of bytes to write.
+ * @return An error code.
+ * @note Cached data is only written to the SRAM chip when its cache line
+ *       is replaced, or when the area is flushed.
+ * @see xmem_flush
+ */
+int xmem_write(struct xmem *xm, xmem_t addr, const void *buff, size_t len)
+{
+	int rv;
+
+	if(!buff || !xmem_in_range(xm, addr, len))
+		return -EINVAL;
+
+	mutex_lock(&xm->lock);
+	rv = raw_xmem_access(xm, addr, buff, NULL, len);
+	mutex_unlock(&xm->lock);
+
+	return rv;
+}
+
+/**
+ * @brief Pin external memory in the cache.
+ * @param xm External memory area.
+ * @param addr Address of the memory to pin.
+ * @param len Number of bytes to pin.
+ * @return A pointer to the cached memory or \p NULL.
+ *
+ * The returned pointer stays valid until the memory is unpinned. The memory
+ * can't cross a cache line boundary. Allocations of at most
+ * XMEM_LINE_SIZE - 2 bytes never do.
+ *
+ * @see xmem_unpin
+ */
+void *xmem_pin(struct xmem *xm, xmem_t addr, size_t len)
+{
+	struct xmem_line *line;
+	xmem_t tag;
+	void *ptr = NULL;
+
+	tag = xmem_line_addr(addr);
+	if(!len || addr - tag + len > XMEM_LINE_SIZE ||
+			!xmem_in_range(xm, addr, len))
+		return NULL;
+
+	mutex_lock(&xm->lock);
+	line = xmem_lookup(xm, tag);
+	if(!line)
+		line = xmem_load(xm, tag);
+
+	if(line) {
+		line->pins++;
+		xmem_touch(xm, line);
+		ptr = line->data + (addr - tag);
+	}
+	mutex_unlock(&xm->lock);
+
+	return ptr;
+}
+
+/**
+ * @brief Unpin external memory.
+ * @param xm External memory area.
+ * @param addr Address that was passed to xmem_pin.
+ * @param dirty Set to true if the pinned memory was modified.
+ */
+void xmem_unpin(struct xmem *xm, xmem_t addr, bool dirty)
+{
+	struct xmem_line *line;
+
+	mutex_lock(&xm->lock);
+	line = xmem_lookup(xm, xmem_line_addr(addr));
+	if(line && line->pins) {
+		line->pins--;
+		if(dirty)
+			set_bit(XMEM_LINE_DIRTY, &line->flags);
+	}
+	mutex_unlock(&xm->lock);
+}
+
+/**
+ * @brief Write all modified cache lines back to the SRAM chip.
+ * @param xm External memory area to flush.
+ * @return An error code.
+ */
+int xmem_flush(struct xmem *xm)
+{
+	int idx, rv, err = -EOK;
+
+	mutex_lock(&xm->lock);
+	for(idx = 0; idx < CONFIG_XMEM_CACHE_LINES; idx++) {
+		rv = xmem_writeback(xm, &xm->lines[idx]);
+		if(rv)
+			err = rv;
+	}
+	mutex_unlock(&xm->lock);
+
+	return err;
+}
+
+/** @} */
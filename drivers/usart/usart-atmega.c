@@ -30,57 +30,119 @@
 #include <etaos/spinlock.h>
 #include <etaos/bitops.h>
 #include <etaos/init.h>
+#include <etaos/irq.h>
+
+#include <etaos/ringbuffer.h>
 
 #include <asm/io.h>
 #include <asm/usart.h>
 
-static mutex_t usart_rx_mtx;
-static uint8_t *usart_rx_buff;
-static size_t usart_rx_len;
-static size_t usart_rx_idx;
+#if CONFIG_USART_RX_BUFFER_SIZE & (CONFIG_USART_RX_BUFFER_SIZE - 1)
+#error "The USART RX buffer size should be a power of two"
+#endif
+
+DEFINE_RING_BUFFER(usart_rx_rb, CONFIG_USART_RX_BUFFER_SIZE);
 
-static int atmega_usart_putc(struct usart *usart, int c)
+#ifdef CONFIG_ATMEGA_USART_TX_IRQ
+#if CONFIG_USART_TX_BUFFER_SIZE & (CONFIG_USART_TX_BUFFER_SIZE - 1)
+#error "The USART TX buffer size should be a power of two"
+#endif
+
+DEFINE_RING_BUFFER(usart_tx_rb, CONFIG_USART_TX_BUFFER_SIZE);
+
+/**
+ * @brief Flush the TX buffer and send a byte by polling.
+ * @param c Byte to send.
+ * @note Interrupts should be disabled.
+ *
+ * Used when the UDRE interrupt can't run: from IRQ context, or when
+ * interrupts have been disabled (i.e. by panic). The bytes in the TX buffer
+ * are sent first, so the output stays in order.
+ */
+static void atmega_usart_tx_sync(int c)
 {
-	if(c == '\n')
-		atmega_usart_putc(usart, '\r');
+	int b;
+#ifdef CONFIG_EVENT_MUTEX
+	bool full;
+
+	full = ring_buffer_full(&usart_tx_rb);
+#endif
+	while((b = ring_buffer_get(&usart_tx_rb)) >= 0) {
+		while(( UCSR0A & BIT(UDRE0) ) == 0);
+		UDR0 = b;
+	}
 
-	irq_enter_critical();
 	while(( UCSR0A & BIT(UDRE0) ) == 0);
-	UCSR0A |= BIT(TXCn);
 	UDR0 = c;
-	irq_exit_critical();
 
-	return c;
+#ifdef CONFIG_EVENT_MUTEX
+	if(full)
+		ring_buffer_wake(&usart_tx_rb);
+#endif
 }
 
-static int atmega_usart_getc(struct usart *usart)
+static int atmega_usart_putc(struct usart *usart, int c)
 {
-	int c = 0;
+	unsigned long flags;
 
-	irq_enter_critical();
-	usart_rx_buff = (uint8_t*)&c;
-	usart_rx_len = 1;
-	usart_rx_idx = 0;
-	irq_exit_critical();
+	if(c == '\n')
+		atmega_usart_putc(usart, '\r');
+
+	if(irqs_disabled()) {
+		atmega_usart_tx_sync(c);
+		return c;
+	}
+
+	while(ring_buffer_put(&usart_tx_rb, c)) {
+#ifdef CONFIG_EVENT_MUTEX
+		raw_event_wait(&usart_tx_rb.wq, 0);
+#endif
+	}
+
+	irq_save_and_disable(&flags);
+	UCSR0B |= BIT(UDRIE0);
+	irq_restore(&flags);
 
-	mutex_wait(&usart_rx_mtx);
 	return c;
 }
 
-static int atmega_usart_read(struct usart *uart, void *rx, size_t rxlen)
+static irqreturn_t usart_udre_irq(struct irq_data *data, void *arg)
 {
-	if(!rx)
-		return -EINVAL;
+	int c;
+#ifdef CONFIG_EVENT_MUTEX
+	bool full;
+
+	full = ring_buffer_full(&usart_tx_rb);
+#endif
+	c = ring_buffer_get(&usart_tx_rb);
+	if(c < 0) {
+		UCSR0B &= ~BIT(UDRIE0);
+		return IRQ_HANDLED;
+	}
+
+	UDR0 = c;
+#ifdef CONFIG_EVENT_MUTEX
+	if(full)
+		ring_buffer_wake_irq(&usart_tx_rb);
+#endif
+
+	return IRQ_HANDLED;
+}
+#else
+static int atmega_usart_putc(struct usart *usart, int c)
+{
+	if(c == '\n')
+		atmega_usart_putc(usart, '\r');
 
 	irq_enter_critical();
-	usart_rx_buff = rx;
-	usart_rx_len = rxlen;
-	usart_rx_idx = 0;
+	while(( UCSR0A & BIT(UDRE0) ) == 0);
+	UCSR0A |= BIT(TXCn);
+	UDR0 = c;
 	irq_exit_critical();
 
-	mutex_wait(&usart_rx_mtx);
-	return -EOK;
+	return c;
 }
+#endif
 
 static int atmega_usart_write(struct usart *uart, const void *tx,
 			size_t txlen)
@@ -106,28 +168,33 @@ static int atmega_usart_write(struct usart *uart, const void *tx,
 
 static struct usart atmega_usart = {
 	.putc = atmega_usart_putc,
-	.getc = atmega_usart_getc,
+	.getc = usart_rx_getc,
 	.write = atmega_usart_write,
-	.read = atmega_usart_read,
+	.read = usart_rx_read,
 	.timeout = 0,
+	.rx_timeout = 0,
+	.rxbuf = &usart_rx_rb,
+	.read_mode = USART_READ_FILL,
+	.delim = '\n',
 	.dev = { .name = "atm-usart", },
 };
 
 static irqreturn_t usart_rx_irq(struct irq_data *data, void *arg)
 {
-	if(!usart_rx_len || !usart_rx_buff || usart_rx_idx >= usart_rx_len)
-		return IRQ_HANDLED;
+	uint8_t c;
+#ifdef CONFIG_EVENT_MUTEX
+	bool empty;
 
-	if(usart_rx_idx < usart_rx_len) {
-		usart_rx_buff[usart_rx_idx] = UDR0;
-		usart_rx_idx++; /* AVRICC breaks if we don't do this
-				   seperately */
-	}
+	empty = ring_buffer_empty(&usart_rx_rb);
+#endif
+	c = UDR0;
+	if(ring_buffer_put(&usart_rx_rb, c))
+		return IRQ_HANDLED;
 
-	if(usart_rx_idx >= usart_rx_len) {
-		usart_rx_idx = 0;
-		mutex_unlock_from_irq(&usart_rx_mtx);
-	}
+#ifdef CONFIG_EVENT_MUTEX
+	if(empty)
+		ring_buffer_wake_irq(&usart_rx_rb);
+#endif
 
 	return IRQ_HANDLED;
 }
@@ -139,10 +206,6 @@ static __used void atmega_usart_init(void)
 {
 	uint16_t baud;
 
-	usart_rx_buff = NULL;
-	usart_rx_len = 0;
-	usart_rx_idx = 0;
-
 	baud = (F_CPU / 4 / BAUD - 1) / 2;
 	UCSR0A |= BIT(U2X0);
 
@@ -155,8 +218,11 @@ static __used void atmega_usart_init(void)
 	UCSR0C = BIT(UCSZ01) | BIT(UCSZ00);
 	UCSR0B = BIT(RXEN0) | BIT(TXEN0) | BIT(RXCIE0);
 
-	mutex_init(&usart_rx_mtx);
 	usart_initialise(&atmega_usart);
+#ifdef CONFIG_ATMEGA_USART_TX_IRQ
+	irq_request(USART_UDRE_NUM, &usart_udre_irq, IRQ_FALLING_MASK,
+			&atmega_usart);
+#endif
 #ifdef CONFIG_STDIO_USART
 	setup_usart_streams(&atmega_usart);
 #endif
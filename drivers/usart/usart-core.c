@@ -24,6 +24,10 @@
 #include <etaos/error.h>
 #include <etaos/init.h>
 
+#ifdef CONFIG_RING_BUFFER
+#include <etaos/ringbuffer.h>
+#endif
+
 static inline struct usart *to_usart_dev(struct file * file)
 {
 	struct device *dev;
@@ -84,14 +88,196 @@ static int usart_getc(struct file * stream)
 	return rv;
 }
 
+/**
+ * @brief Configure a USART device.
+ * @param file Device file of the USART.
+ * @param reg Option to set, see usart_ioctl_t.
+ * @param buf Argument to \p reg.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p reg is not supported.
+ *
+ * The read settings don't wait for a blocked reader, they are applied by
+ * the next read. Flushing the RX buffer does wait for the current read to
+ * finish.
+ */
+static int usart_ioctl(struct file *file, unsigned long reg, void *buf)
+{
+	struct usart *usart;
+	int rc = -EOK;
+
+	usart = to_usart_dev(file);
+
+	switch(reg) {
+	case USART_SET_READ_MODE:
+		spin_lock(&usart->cfg);
+		usart->read_mode = *(int*)buf;
+		spin_unlock(&usart->cfg);
+		break;
+
+	case USART_SET_RX_TIMEOUT:
+		spin_lock(&usart->cfg);
+		usart->rx_timeout = *(int*)buf;
+		spin_unlock(&usart->cfg);
+		break;
+
+	case USART_SET_DELIMITER:
+		spin_lock(&usart->cfg);
+		usart->delim = *(int*)buf;
+		spin_unlock(&usart->cfg);
+		break;
+
+#ifdef CONFIG_RING_BUFFER
+	case USART_GET_RX_COUNT:
+		if(!usart->rxbuf) {
+			rc = -EINVAL;
+			break;
+		}
+
+		*(size_t*)buf = ring_buffer_count(usart->rxbuf);
+		break;
+
+	case USART_FLUSH_RX:
+		if(!usart->rxbuf) {
+			rc = -EINVAL;
+			break;
+		}
+
+		/* Resetting the buffer consumes it, like a read does */
+		mutex_lock(&usart->rx);
+		ring_buffer_reset(usart->rxbuf);
+		mutex_unlock(&usart->rx);
+		break;
+#endif
+
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	return rc;
+}
+
 static struct dev_file_ops usart_fops = {
 	.write = &usart_write,
 	.read = &usart_read,
 	.put = &usart_putc,
 	.get = &usart_getc,
+	.ioctl = &usart_ioctl,
 	.open = NULL,
 };
 
+#ifdef CONFIG_RING_BUFFER
+/**
+ * @brief Wait for data to arrive in the RX buffer.
+ * @param usart USART to wait for.
+ * @param timeout Read timeout, see usart::rx_timeout.
+ * @return An error code.
+ * @retval -EOK if data is available.
+ * @retval -EAGAIN if no data arrived within \p timeout.
+ */
+static int usart_rx_wait(struct usart *usart, int timeout)
+{
+	struct ring_buffer *rb = usart->rxbuf;
+
+	if(timeout == USART_NONBLOCK)
+		return -EAGAIN;
+
+#ifdef CONFIG_EVENT_MUTEX
+	while(ring_buffer_empty(rb)) {
+		if(raw_event_wait(&rb->wq, timeout))
+			return ring_buffer_empty(rb) ? -EAGAIN : -EOK;
+	}
+#else
+	while(ring_buffer_empty(rb));
+#endif
+
+	return -EOK;
+}
+
+/**
+ * @brief Read a single byte from the RX buffer of a USART.
+ * @param usart USART to read from.
+ * @return The byte read or an error code.
+ * @retval -EAGAIN if no data arrived within usart::rx_timeout.
+ * @note Can be used as the usart::getc handler of drivers which fill
+ *       usart::rxbuf.
+ */
+int usart_rx_getc(struct usart *usart)
+{
+	int c, timeout;
+
+	spin_lock(&usart->cfg);
+	timeout = usart->rx_timeout;
+	spin_unlock(&usart->cfg);
+
+	while((c = ring_buffer_get(usart->rxbuf)) < 0) {
+		if(usart_rx_wait(usart, timeout))
+			return -EAGAIN;
+	}
+
+	return c;
+}
+
+/**
+ * @brief Read from the RX buffer of a USART.
+ * @param usart USART to read from.
+ * @param rx Buffer to store the data in.
+ * @param len Length of \p rx.
+ * @return The number of bytes read or an error code.
+ * @retval -EINVAL if \p rx is \p NULL.
+ * @note Can be used as the usart::read handler of drivers which fill
+ *       usart::rxbuf.
+ *
+ * The amount of data read depends on usart::read_mode. In every mode the
+ * read ends early when no data arrives within usart::rx_timeout, which makes
+ * the timeout usable as an idle line detector. The settings are sampled once
+ * at the start of the read.
+ */
+int usart_rx_read(struct usart *usart, void *rx, size_t len)
+{
+	uint8_t *data = rx;
+	usart_read_mode_t mode;
+	int c, delim, timeout;
+	size_t num;
+
+	if(!rx)
+		return -EINVAL;
+
+	spin_lock(&usart->cfg);
+	mode = usart->read_mode;
+	delim = usart->delim;
+	timeout = usart->rx_timeout;
+	spin_unlock(&usart->cfg);
+
+	num = 0;
+	while(num < len) {
+		if(mode == USART_READ_DELIM) {
+			c = ring_buffer_get(usart->rxbuf);
+			if(c >= 0) {
+				data[num++] = c;
+				if(c == delim)
+					break;
+
+				continue;
+			}
+		} else {
+			num += ring_buffer_read(usart->rxbuf, data + num,
+					len - num);
+			if(num >= len)
+				break;
+		}
+
+		if(num && mode == USART_READ_SOME)
+			break;
+		if(usart_rx_wait(usart, timeout))
+			break;
+	}
+
+	return (int)num;
+}
+#endif
+
 void setup_usart_streams(struct usart *usart)
 {
 	struct file * usart_stream;
@@ -115,6 +301,7 @@ int usart_initialise(struct usart *usart)
 	err = device_initialize(&usart->dev, &usart_fops);
 	mutex_init(&usart->rx);
 	mutex_init(&usart->tx);
+	spinlock_init(&usart->cfg);
 	if(err)
 		return err;
 
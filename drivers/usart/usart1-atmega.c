@@ -30,62 +30,172 @@
 #include <etaos/spinlock.h>
 #include <etaos/bitops.h>
 #include <etaos/init.h>
+#include <etaos/irq.h>
+
+#include <etaos/ringbuffer.h>
 
 #include <asm/io.h>
 #include <asm/usart.h>
 
-static mutex_t usart_mtx;
+#if CONFIG_USART1_RX_BUFFER_SIZE & (CONFIG_USART1_RX_BUFFER_SIZE - 1)
+#error "The USART1 RX buffer size should be a power of two"
+#endif
+
+DEFINE_RING_BUFFER(usart1_rx_rb, CONFIG_USART1_RX_BUFFER_SIZE);
 
+#ifdef CONFIG_ATMEGA_USART_TX_IRQ
+#if CONFIG_USART1_TX_BUFFER_SIZE & (CONFIG_USART1_TX_BUFFER_SIZE - 1)
+#error "The USART1 TX buffer size should be a power of two"
+#endif
+
+DEFINE_RING_BUFFER(usart1_tx_rb, CONFIG_USART1_TX_BUFFER_SIZE);
+#else
+static mutex_t usart_mtx;
 static volatile const uint8_t *usart_tx_buff;
 static volatile size_t usart_tx_len;
 static volatile size_t usart_tx_idx;
+#endif
 
-static volatile uint8_t *usart_rx_buff;
-static volatile size_t usart_rx_len;
-static volatile size_t usart_rx_idx;
+#ifdef CONFIG_ATMEGA_USART_TX_IRQ
+/**
+ * @brief Start emptying the TX buffer.
+ */
+static void atmega_usart_tx_start(void)
+{
+	unsigned long flags;
 
-static int atmega_usart_putc(struct usart *usart, int c)
+	irq_save_and_disable(&flags);
+	UCSR1B |= BIT(UDRIE1);
+	irq_restore(&flags);
+}
+
+/**
+ * @brief Wait until there is room in the TX buffer.
+ */
+static void atmega_usart_tx_wait(void)
 {
-	irq_enter_critical();
-	while(( UCSR1A & BIT(UDRE1) ) == 0);
-	UCSR1A |= BIT(TXCn);
-	UDR1 = c;
-	irq_exit_critical();
+#ifdef CONFIG_EVENT_MUTEX
+	raw_event_wait(&usart1_tx_rb.wq, 0);
+#endif
+}
 
-	return c;
+/**
+ * @brief Flush the TX buffer and send data by polling.
+ * @param data Data to send.
+ * @param len Length of \p data.
+ * @note Interrupts should be disabled.
+ *
+ * Used when the UDRE interrupt can't run: from IRQ context, or when
+ * interrupts have been disabled (i.e. by panic). The bytes in the TX buffer
+ * are sent first, so the output stays in order.
+ */
+static void atmega_usart_tx_sync(const uint8_t *data, size_t len)
+{
+	int c;
+#ifdef CONFIG_EVENT_MUTEX
+	bool full;
+
+	full = ring_buffer_full(&usart1_tx_rb);
+#endif
+	while((c = ring_buffer_get(&usart1_tx_rb)) >= 0) {
+		while(( UCSR1A & BIT(UDRE1) ) == 0);
+		UDR1 = c;
+	}
+
+	for(; len; len--, data++) {
+		while(( UCSR1A & BIT(UDRE1) ) == 0);
+		UDR1 = *data;
+	}
+
+#ifdef CONFIG_EVENT_MUTEX
+	if(full)
+		ring_buffer_wake(&usart1_tx_rb);
+#endif
 }
 
-static int atmega_usart_getc(struct usart *usart)
+static int atmega_usart_putc(struct usart *usart, int c)
 {
-	int c = 0;
+	uint8_t byte;
 
-	irq_enter_critical();
-	usart_rx_buff = (uint8_t*)&c;
-	usart_rx_len = 1;
-	usart_rx_idx = 0;
-	irq_exit_critical();
+	if(irqs_disabled()) {
+		byte = c;
+		atmega_usart_tx_sync(&byte, 1);
+		return c;
+	}
 
-	mutex_wait(&usart_mtx);
+	while(ring_buffer_put(&usart1_tx_rb, c))
+		atmega_usart_tx_wait();
+
+	atmega_usart_tx_start();
 	return c;
 }
 
-static int atmega_usart_read(struct usart *uart, void *rx, size_t rxlen)
+static int atmega_usart_write(struct usart *uart, const void *tx,
+			size_t txlen)
 {
-	if(!rx)
+	const uint8_t *data = tx;
+	size_t num;
+
+	if(!tx)
 		return -EINVAL;
 
+	if(irqs_disabled()) {
+		atmega_usart_tx_sync(data, txlen);
+		return -EOK;
+	}
+
+	while(true) {
+		num = ring_buffer_write(&usart1_tx_rb, data, txlen);
+		data += num;
+		txlen -= num;
+
+		if(num)
+			atmega_usart_tx_start();
+		if(!txlen)
+			break;
+
+		atmega_usart_tx_wait();
+	}
+
+	return -EOK;
+}
+
+static irqreturn_t usart_udre_irq(struct irq_data *data, void *arg)
+{
+	int c;
+#ifdef CONFIG_EVENT_MUTEX
+	bool full;
+
+	full = ring_buffer_full(&usart1_tx_rb);
+#endif
+	c = ring_buffer_get(&usart1_tx_rb);
+	if(c < 0) {
+		UCSR1B &= ~BIT(UDRIE1);
+		return IRQ_HANDLED;
+	}
+
+	UDR1 = c;
+#ifdef CONFIG_EVENT_MUTEX
+	if(full)
+		ring_buffer_wake_irq(&usart1_tx_rb);
+#endif
+
+	return IRQ_HANDLED;
+}
+#else
+static int atmega_usart_putc(struct usart *usart, int c)
+{
 	irq_enter_critical();
-	usart_rx_buff = rx;
-	usart_rx_len = rxlen;
-	usart_rx_idx = 0;
-	UCSR1B |= BIT(RXCIE1);
+	while(( UCSR1A & BIT(UDRE1) ) == 0);
+	UCSR1A |= BIT(TXCn);
+	UDR1 = c;
 	irq_exit_critical();
 
-	mutex_wait(&usart_mtx);
-	UCSR1B &= ~BIT(RXCIE1);
-	return -EOK;
+	return c;
 }
+#endif
 
+#ifndef CONFIG_ATMEGA_USART_TX_IRQ
 static volatile bool tx_done = true;
 static int atmega_usart_write(struct usart *uart, const void *tx,
 			size_t txlen)
@@ -107,25 +217,29 @@ static int atmega_usart_write(struct usart *uart, const void *tx,
 
 	return -EOK;
 }
+#endif
 
 static irqreturn_t usart_rx_irq(struct irq_data *data, void *arg)
 {
-	if(unlikely(!usart_rx_len || !usart_rx_buff ||
-		!(usart_rx_idx < usart_rx_len)))
+	uint8_t c;
+#ifdef CONFIG_EVENT_MUTEX
+	bool empty;
+
+	empty = ring_buffer_empty(&usart1_rx_rb);
+#endif
+	c = UDR1;
+	if(ring_buffer_put(&usart1_rx_rb, c))
 		return IRQ_HANDLED;
 
-	usart_rx_buff[usart_rx_idx] = UDR1;
-	usart_rx_idx++; /* AVRICC breaks if we don't do this seperately */
-
-	if(usart_rx_idx >= usart_rx_len) {
-		usart_rx_idx = 0;
-		usart_rx_buff = NULL;
-		mutex_unlock_from_irq(&usart_mtx);
-	}
+#ifdef CONFIG_EVENT_MUTEX
+	if(empty)
+		ring_buffer_wake_irq(&usart1_rx_rb);
+#endif
 
 	return IRQ_HANDLED;
 }
 
+#ifndef CONFIG_ATMEGA_USART_TX_IRQ
 static irqreturn_t usart_udre_irq(struct irq_data *data, void *arg)
 {
 	if(unlikely(!usart_tx_buff || !usart_tx_len ||
@@ -147,13 +261,18 @@ static irqreturn_t usart_udre_irq(struct irq_data *data, void *arg)
 
 	return IRQ_HANDLED;
 }
+#endif
 
 static struct usart atmega_usart1 = {
 	.putc = atmega_usart_putc,
-	.getc = atmega_usart_getc,
+	.getc = usart_rx_getc,
 	.write = atmega_usart_write,
-	.read = atmega_usart_read,
+	.read = usart_rx_read,
 	.timeout = 0,
+	.rx_timeout = 0,
+	.rxbuf = &usart1_rx_rb,
+	.read_mode = USART_READ_FILL,
+	.delim = '\n',
 	.dev = { .name = "atm-usart1", },
 };
 
@@ -161,12 +280,11 @@ static __used void atmega_usart1_init(void)
 {
 	uint16_t baud;
 
-	usart_rx_buff = NULL;
-	usart_rx_len = 0;
-	usart_rx_idx = 0;
+#ifndef CONFIG_ATMEGA_USART_TX_IRQ
 	usart_tx_buff = NULL;
 	usart_tx_len = 0;
 	usart_tx_idx = 0;
+#endif
 
 	baud = (F_CPU / 4 / CONFIG_USART1_BAUD - 1) / 2;
 	UCSR1A |= BIT(U2X1);
@@ -178,9 +296,11 @@ static __used void atmega_usart1_init(void)
 
 	UBRR1 = baud;
 	UCSR1C = BIT(UCSZ11) | BIT(UCSZ10);
-	UCSR1B = BIT(RXEN1) | BIT(TXEN1);
+	UCSR1B = BIT(RXEN1) | BIT(TXEN1) | BIT(RXCIE1);
 
+#ifndef CONFIG_ATMEGA_USART_TX_IRQ
 	mutex_init(&usart_mtx);
+#endif
 
 	usart_initialise(&atmega_usart1);
 	irq_request(USART1_RX_COMPLETE_VECTOR_NUM, &usart_rx_irq, IRQ_FALLING_MASK,
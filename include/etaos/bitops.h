@@ -79,6 +79,19 @@ static inline void clear_bit(unsigned bit, volatile unsigned long *addr)
 	addr[bit / BITS_PER_LONG] &= ~(1UL << (bit % BITS_PER_LONG));
 }
 #endif
+
+#ifndef CONFIG_ARCH_FFS
+/**
+ * @brief Find the first (least significant) set bit in a word.
+ * @param word Word to search.
+ * @return The index of the first set bit plus one.
+ * @retval 0 if no bits are set in \p word.
+ */
+static inline int ffs_long(unsigned long word)
+{
+	return __builtin_ffsl(word);
+}
+#endif
 CDECL_END
 #endif
 
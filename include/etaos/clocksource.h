@@ -25,6 +25,23 @@
 #include <etaos/spinlock.h>
 
 struct timer;
+
+#ifdef CONFIG_TIMER_WHEEL
+#define TIMER_WHEEL_SIZE (1 << CONFIG_TIMER_WHEEL_BITS) //!< Slots per level.
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1) //!< Slot index mask.
+
+/**
+ * @struct timer_wheel
+ * @brief Hierarchical timer wheel.
+ */
+struct timer_wheel {
+	tick_t clk; //!< Next tick to be processed.
+	unsigned long pending; //!< Number of timers on the wheel.
+	/** @brief Timer slots. */
+	struct list_head vec[CONFIG_TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+};
+#endif
+
 /**
  * @struct clocksource
  * @brief The clocksource describes the source of a hardware time.
@@ -41,6 +58,9 @@ struct clocksource {
 	struct list_head list; //!< List of clocksources.
 	struct list_head timers; //!< Timer list head.
 	struct timer *thead; //!< Timer list head.
+#ifdef CONFIG_TIMER_WHEEL
+	struct timer_wheel *wheel; //!< Timer wheel.
+#endif
 };
 
 CDECL
@@ -28,5 +28,6 @@
 #define EBADF            6
 #define EEXIST           7
 #define EOF		 8
+#define ETIMEDOUT	 9
 
 #endif
@@ -80,6 +80,18 @@ extern irqreturn_t hrtimer_tick(struct irq_data *data, void *arg);
 extern void hrtimer_init(int irq, struct clocksource *src);
 extern int hrtimer_stop(struct hrtimer *timer);
 extern void hrtimer_handle(struct clocksource *cs);
+
+/**
+ * @ingroup archAPI
+ * @brief Read the hardware counter behind the high resolution clock.
+ * @return A free running cycle count.
+ * @note This function can be called with interrupts disabled. Unlike the
+ *       tick count of hr_sys_clk, the returned value keeps advancing.
+ *
+ * The resolution is architecture dependent. The simulator counts
+ * nanoseconds.
+ */
+extern unsigned long arch_hrtimer_cycles(void);
 CDECL_END
 
 /** @} */
@@ -32,6 +32,8 @@
 #include <etaos/thread.h>
 #include <etaos/types.h>
 #include <etaos/spinlock.h>
+#include <etaos/event.h>
+#include <etaos/msgring.h>
 
 /**
  * @struct ipm
@@ -45,21 +47,25 @@ struct ipm {
 /**
  * @struct ipm_queue
  * @brief IPM waiting queue.
+ *
+ * The message array is used as a ring buffer, indexed by ipm_queue::ring.
  */
 struct ipm_queue {
-	struct thread_queue qp; //!< Thread queue to wait in.
-	uint8_t num; //!< Length of the message array.
-	uint8_t wr_idx; //!< Write index.
-	uint8_t rd_idx; //!< Read index.
+	struct msg_ring ring; //!< Slot bookkeeping of ipm_queue::msgs.
 	struct ipm *msgs; //!< Message array.
-	spinlock_t lock; //!< Concurrency lock.
 };
 
 CDECL
 
 extern void ipm_queue_init(struct ipm_queue *qp, size_t len);
 extern int ipm_post_msg(struct ipm_queue *qp, const void *data, size_t len);
+extern int ipm_post_msg_wait(struct ipm_queue *iq, const void *data,
+		size_t len, unsigned ms);
 extern int ipm_get_msg(struct ipm_queue *qp, struct ipm *msg);
+extern int ipm_get_msg_tmo(struct ipm_queue *iq, struct ipm *msg,
+		unsigned ms);
+extern int ipm_get_msgs(struct ipm_queue *iq, struct ipm *msgs, size_t num,
+		unsigned ms);
 extern bool ipm_reset_queue(struct ipm_queue *iq);
 
 CDECL_END
@@ -44,6 +44,9 @@ struct heap_node {
 	size_t size; //!< Size of the node.
 #ifdef CONFIG_MM_TRACE_OWNER
 	struct thread *owner; //!< Owner of the memory region.
+#endif
+#ifdef CONFIG_MM_TRACE
+	const void *site; //!< Call site that allocated the region.
 #endif
 	struct heap_node *next; //!< Heap node list pointer.
 };
@@ -71,6 +74,7 @@ typedef enum allocator {
 	BEST_FIT, //!< Best fit allocator
 	FIRST_FIT, //!< First fit allocator
 	WORST_FIT, //!< Worst fit allocator
+	SEGREGATED_FIT, //!< Segregated fit allocator
 	SYSTEM_ALLOCATOR, //!< Default allocator
 } allocator_t;
 
@@ -79,6 +83,35 @@ typedef enum allocator {
  */
 typedef int (mm_comparator_t)(struct heap_node *, struct heap_node *);
 
+#ifdef CONFIG_MM_TRACE
+/**
+ * @brief Allocation statistics of a single call site.
+ */
+struct mm_site_stats {
+	const void *site; //!< Return address of the allocation call.
+	unsigned long allocs; //!< Number of allocations.
+	unsigned long frees; //!< Number of releases.
+	size_t in_use; //!< Number of heap bytes in use.
+};
+
+/**
+ * @brief Heap statistics.
+ * @note Sizes include the allocator overhead.
+ */
+struct mm_stats {
+	unsigned long allocs; //!< Number of allocations.
+	unsigned long frees; //!< Number of releases.
+	unsigned long failures; //!< Number of failed allocations.
+	unsigned long untracked; //!< Allocations from sites that didn't fit.
+	size_t in_use; //!< Number of heap bytes in use.
+	size_t peak; //!< Peak value of mm_stats::in_use.
+	unsigned long timed; //!< Number of timed allocations.
+	unsigned long max_time; //!< Longest allocation in HR clock cycles.
+	unsigned long total_time; //!< Total allocation time in HR clock cycles.
+	struct mm_site_stats sites[CONFIG_MM_TRACE_SITES]; //!< Call sites.
+};
+#endif
+
 /**
  * @}
  */
@@ -89,14 +122,25 @@ extern struct heap_node *mm_free_list;
 
 CDECL
 extern MEM void *mm_best_fit_alloc(size_t size);
+extern MEM void *__mm_best_fit_alloc(size_t size, const void *site);
 extern int mm_best_fit_compare(struct heap_node *prev, struct heap_node *current);
 
 extern int mm_first_fit_compare(struct heap_node *prev, struct heap_node *current);
 extern MEM void *mm_first_fit_alloc(size_t size);
+extern MEM void *__mm_first_fit_alloc(size_t size, const void *site);
 
 extern MEM void *mm_worst_fit_alloc(size_t size);
+extern MEM void *__mm_worst_fit_alloc(size_t size, const void *site);
 extern int mm_worst_fit_compare(struct heap_node *prev, struct heap_node *current);
 
+extern MEM void *mm_sf_alloc(size_t size);
+extern void *raw_mm_sf_alloc(size_t size);
+extern int raw_mm_sf_free(void *ptr);
+extern void raw_mm_sf_add_block(void *addr, size_t size);
+extern size_t raw_mm_sf_node_size(void *ptr);
+extern size_t raw_mm_sf_available(void);
+extern size_t raw_mm_sf_largest_block(void);
+
 #ifdef CONFIG_MM_DEBUG
 extern int mm_free(void*, const char *, int);
 #define kfree(__p) mm_free(__p, __FILE__, __LINE__)
@@ -116,6 +160,7 @@ extern void raw_mm_heap_add_block(void *start, size_t size);
 extern size_t mm_node_size(void *ptr);
 
 extern MEM void* mm_alloc(size_t);
+extern MEM void *__mm_alloc(size_t size, const void *site);
 extern MEM void *mm_alloc_aligned(size_t size, size_t alignment);
 
 extern void *kzalloc(size_t num);
@@ -124,6 +169,12 @@ extern void *kcalloc(size_t, size_t);
 extern void *krealloc(void *old, size_t newsize);
 
 extern size_t mm_heap_available(void);
+extern size_t mm_heap_largest_block(void);
+extern unsigned int mm_heap_fragmentation(void);
+
+#ifdef CONFIG_MM_TRACE
+extern void mm_get_stats(struct mm_stats *stats);
+#endif
 CDECL_END
 
 #endif
@@ -0,0 +1,111 @@
+/*
+ *  ETA/OS - Fixed size object pools
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file etaos/mempool.h */
+
+#ifndef __MEMPOOL_H__
+#define __MEMPOOL_H__
+
+/**
+ * @addtogroup mempool
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/spinlock.h>
+
+/**
+ * @brief Fixed size object pool.
+ *
+ * Objects are handed out from the backing storage in order until it is
+ * used up. Released objects are kept on an intrusive free list, which is
+ * threaded through the first word of the free objects.
+ */
+struct mem_pool {
+	void *free; //!< Free list of released objects.
+	uint8_t *next; //!< First object that has never been handed out.
+	uint8_t *start; //!< Start of the backing storage.
+	uint8_t *end; //!< End of the backing storage.
+	size_t obj_size; //!< Size of a single object.
+	spinlock_t lock; //!< Pool lock.
+};
+
+/**
+ * @brief Get the size of a pool object.
+ * @param __s Requested object size.
+ *
+ * Pool objects have to be large enough to store a free list pointer. The
+ * size is rounded up to a multiple of the pointer size, so every object in
+ * the pool is suitably aligned to hold one.
+ */
+#define MEM_POOL_OBJ_SIZE(__s) \
+	((__s) < sizeof(void*) ? sizeof(void*) : \
+	 ((__s) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*))
+
+/**
+ * @brief Static pool initialiser.
+ * @param __storage Backing storage.
+ * @param __size Object size.
+ * @param __num Number of objects in the pool.
+ */
+#define MEM_POOL_INIT(__storage, __size, __num) { \
+	.free = NULL, \
+	.next = (uint8_t*)(__storage), \
+	.start = (uint8_t*)(__storage), \
+	.end = (uint8_t*)(__storage) + MEM_POOL_OBJ_SIZE(__size) * (__num), \
+	.obj_size = MEM_POOL_OBJ_SIZE(__size), \
+	.lock = STATIC_SPIN_LOCK_INIT, \
+}
+
+/**
+ * @brief Define a statically allocated object pool.
+ * @param __name Name of the pool.
+ * @param __size Object size.
+ * @param __num Number of objects in the pool.
+ *
+ * The backing storage of the pool is placed in the .bss section.
+ */
+#define DEFINE_MEM_POOL(__name, __size, __num) \
+	static void *__name##_storage[MEM_POOL_OBJ_SIZE(__size) / \
+			sizeof(void*) * (__num)]; \
+	struct mem_pool __name = MEM_POOL_INIT(__name##_storage, __size, __num)
+
+/**
+ * @brief Check if an object belongs to a pool.
+ * @param pool Pool to check.
+ * @param obj Object to check.
+ * @return True if \p obj is part of the storage of \p pool.
+ */
+static inline bool mem_pool_contains(struct mem_pool *pool, void *obj)
+{
+	return (uint8_t*)obj >= pool->start && (uint8_t*)obj < pool->end;
+}
+
+CDECL
+extern void mem_pool_init(struct mem_pool *pool, void *storage,
+		size_t obj_size, size_t num);
+extern struct mem_pool *mem_pool_create(size_t obj_size, size_t num);
+extern void *mem_pool_alloc(struct mem_pool *pool);
+extern void *mem_pool_zalloc(struct mem_pool *pool);
+extern int mem_pool_free(struct mem_pool *pool, void *obj);
+extern size_t mem_pool_available(struct mem_pool *pool);
+CDECL_END
+
+/** @} */
+#endif
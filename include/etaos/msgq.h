@@ -0,0 +1,78 @@
+/*
+ *  ETA/OS - Message queues
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file etaos/msgq.h
+ */
+
+/**
+ * @addtogroup msgq
+ */
+/* @{ */
+
+#ifndef __MSGQ_H__
+#define __MSGQ_H__
+
+#include <etaos/kernel.h>
+#include <etaos/thread.h>
+#include <etaos/types.h>
+#include <etaos/spinlock.h>
+#include <etaos/event.h>
+#include <etaos/msgring.h>
+
+/**
+ * @brief Size of a single message slot.
+ * @param __size Maximum message size.
+ * @note Every slot stores the message length in front of the message.
+ */
+#define MSGQ_SLOT_SIZE(__size) ((__size) + 1)
+
+/**
+ * @brief Size of a message pool.
+ * @param __size Maximum message size.
+ * @param __depth Number of messages.
+ * @see msgq_init_pool
+ */
+#define MSGQ_POOL_SIZE(__size, __depth) (MSGQ_SLOT_SIZE(__size) * (__depth))
+
+/**
+ * @struct msgq
+ * @brief Message queue.
+ *
+ * The message slots are used as a ring buffer, indexed by msgq::ring.
+ */
+struct msgq {
+	struct msg_ring ring; //!< Slot bookkeeping of msgq::pool.
+	uint8_t *pool; //!< Message slots.
+	uint8_t size; //!< Maximum message size.
+};
+
+CDECL
+
+extern int msgq_init_pool(struct msgq *mq, void *pool, size_t size,
+		size_t depth);
+extern int msgq_init(struct msgq *mq, size_t size, size_t depth);
+extern int msgq_send(struct msgq *mq, const void *data, size_t len);
+extern int msgq_send_wait(struct msgq *mq, const void *data, size_t len,
+		unsigned ms);
+extern int msgq_recv(struct msgq *mq, void *buff, size_t len, unsigned ms);
+
+CDECL_END
+#endif
+
+/* @} */
@@ -0,0 +1,79 @@
+/*
+ *  ETA/OS - Message rings
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file etaos/msgring.h
+ */
+
+/**
+ * @addtogroup ipm
+ */
+/* @{ */
+
+#ifndef __MSGRING_H__
+#define __MSGRING_H__
+
+#include <etaos/kernel.h>
+#include <etaos/thread.h>
+#include <etaos/types.h>
+#include <etaos/spinlock.h>
+
+/**
+ * @struct msg_ring
+ * @brief Slot bookkeeping of a bounded message queue.
+ *
+ * Shared by IPM queues and message queues. The ring only keeps track of the
+ * slot indices and the waiting threads, the owner stores the messages.
+ * msg_ring::wr_idx and msg_ring::rd_idx wrap around at msg_ring::num.
+ */
+struct msg_ring {
+	struct thread_queue qp; //!< Receivers waiting for a message.
+	struct thread_queue wq; //!< Senders waiting for a free slot.
+	uint8_t num; //!< Number of slots.
+	uint8_t count; //!< Number of queued messages.
+	uint8_t wr_idx; //!< Write index.
+	uint8_t rd_idx; //!< Read index.
+	spinlock_t lock; //!< Concurrency lock.
+};
+
+CDECL
+/**
+ * @brief Check if a message ring is full.
+ * @param ring Ring to check.
+ * @return True if all slots of \p ring are in use.
+ */
+static inline bool msg_ring_full(struct msg_ring *ring)
+{
+	return ring->count >= ring->num;
+}
+
+extern void msg_ring_init(struct msg_ring *ring, uint8_t num);
+extern bool msg_ring_reset(struct msg_ring *ring);
+extern uint8_t raw_msg_ring_push(struct msg_ring *ring);
+extern uint8_t raw_msg_ring_pop(struct msg_ring *ring);
+extern int msg_ring_wait_msg(struct msg_ring *ring, unsigned long *flags,
+		unsigned ms);
+extern int msg_ring_wait_slot(struct msg_ring *ring, unsigned ms);
+extern void msg_ring_notify_post(struct msg_ring *ring, bool room);
+extern void msg_ring_notify_get(struct msg_ring *ring, bool was_full,
+		bool more);
+CDECL_END
+
+#endif
+
+/* @} */
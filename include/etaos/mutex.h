@@ -92,6 +92,14 @@ extern void mutex_unlock(mutex_t *mutex);
 
 extern void mutex_unlock_irq(mutex_t *mutex);
 
+#ifdef CONFIG_MUTEX_PI
+extern void mutex_lock_pi(mutex_t *mutex);
+extern void mutex_unlock_pi(mutex_t *mutex);
+#else
+#define mutex_lock_pi(_mtx_) mutex_lock(_mtx_)
+#define mutex_unlock_pi(_mtx_) mutex_unlock(_mtx_)
+#endif
+
 /**
  * @brief Initialise a mutex.
  * @param mutex Mutex to initialise.
@@ -143,6 +151,9 @@ static inline void mutex_unlock(mutex_t *mutex)
 {
 	spin_unlock(&mutex->lock);
 }
+
+#define mutex_lock_pi(_mtx_) mutex_lock(_mtx_)
+#define mutex_unlock_pi(_mtx_) mutex_unlock(_mtx_)
 CDECL_END
 
 #endif
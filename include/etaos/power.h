@@ -46,6 +46,16 @@
  * @note This function is blocking, based on the selected mode.
  */
 extern void arch_hibernate(void);
+/**
+ * @ingroup archAPI
+ * @brief Enable interrupts and hibernate the CPU.
+ * @note This function must be called with interrupts disabled.
+ *
+ * Enabling the interrupts and entering the power mode is atomic: an IRQ that
+ * becomes pending in between wakes the CPU up instead of being handled before
+ * it goes to sleep.
+ */
+extern void arch_hibernate_irq_enable(void);
 /**
  * @ingroup archAPI
  * @brief Select a power mode to hibernate into.
@@ -71,6 +81,15 @@ static inline void hibernate(void)
 	arch_hibernate();
 }
 
+/**
+ * @brief Enable interrupts and hibernate the CPU.
+ * @see arch_hibernate_irq_enable
+ */
+static inline void hibernate_irq_enable(void)
+{
+	arch_hibernate_irq_enable();
+}
+
 /** @} */
 #endif /* __POWER_H__ */
 
@@ -0,0 +1,160 @@
+/*
+ *  ETA/OS - Ring buffer
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup ringbuffer
+ * @{
+ */
+
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+
+#ifdef CONFIG_EVENT_MUTEX
+#include <etaos/thread.h>
+#include <etaos/event.h>
+#endif
+
+/**
+ * @brief Ring buffer index type.
+ *
+ * Byte sized indices can be loaded and stored atomically on every supported
+ * architecture. This limits the size of a ring buffer to 256 bytes.
+ */
+typedef uint8_t ring_index_t;
+
+#define RING_BUFFER_MAX_SIZE 256 //!< Maximum ring buffer size.
+
+/**
+ * @brief Single producer, single consumer ring buffer.
+ *
+ * The producer only writes ring_buffer::head and the consumer only writes
+ * ring_buffer::tail, so neither side has to disable interrupts. One slot
+ * is kept empty to tell a full buffer apart from an empty one.
+ */
+struct ring_buffer {
+	uint8_t *buffer; //!< Data buffer.
+	volatile ring_index_t head; //!< Write index, owned by the producer.
+	volatile ring_index_t tail; //!< Read index, owned by the consumer.
+	ring_index_t mask; //!< Size of ring_buffer::buffer minus one.
+#ifdef CONFIG_EVENT_MUTEX
+	struct thread_queue wq; //!< Queue of the waiting side.
+#endif
+};
+
+#ifdef CONFIG_EVENT_MUTEX
+#define RING_BUFFER_WQ_INIT .wq = INIT_THREAD_QUEUE,
+#else
+#define RING_BUFFER_WQ_INIT
+#endif
+
+/**
+ * @brief Define a statically allocated ring buffer.
+ * @param __name Name of the ring buffer.
+ * @param __size Size of the ring buffer, should be a power of two.
+ */
+#define DEFINE_RING_BUFFER(__name, __size) \
+	static uint8_t __name##_data[__size]; \
+	struct ring_buffer __name = { \
+		.buffer = __name##_data, \
+		.head = 0, \
+		.tail = 0, \
+		.mask = (ring_index_t)((__size) - 1), \
+		RING_BUFFER_WQ_INIT \
+	}
+
+CDECL
+/**
+ * @brief Get the number of bytes stored in a ring buffer.
+ * @param rb Ring buffer.
+ * @return The number of bytes that can be read from \p rb.
+ */
+static inline size_t ring_buffer_count(struct ring_buffer *rb)
+{
+	return (ring_index_t)(rb->head - rb->tail) & rb->mask;
+}
+
+/**
+ * @brief Get the amount of free space in a ring buffer.
+ * @param rb Ring buffer.
+ * @return The number of bytes that can be written to \p rb.
+ */
+static inline size_t ring_buffer_space(struct ring_buffer *rb)
+{
+	return (ring_index_t)(rb->tail - rb->head - 1) & rb->mask;
+}
+
+/**
+ * @brief Check if a ring buffer is empty.
+ * @param rb Ring buffer.
+ * @return True if \p rb is empty.
+ */
+static inline bool ring_buffer_empty(struct ring_buffer *rb)
+{
+	return rb->head == rb->tail;
+}
+
+/**
+ * @brief Check if a ring buffer is full.
+ * @param rb Ring buffer.
+ * @return True if \p rb is full.
+ */
+static inline bool ring_buffer_full(struct ring_buffer *rb)
+{
+	return ((rb->head + 1) & rb->mask) == rb->tail;
+}
+
+extern int ring_buffer_init(struct ring_buffer *rb, void *buf, size_t size);
+extern void ring_buffer_reset(struct ring_buffer *rb);
+extern int ring_buffer_put(struct ring_buffer *rb, uint8_t c);
+extern int ring_buffer_get(struct ring_buffer *rb);
+extern size_t ring_buffer_write(struct ring_buffer *rb, const void *buf,
+		size_t len);
+extern size_t ring_buffer_read(struct ring_buffer *rb, void *buf, size_t len);
+
+#ifdef CONFIG_EVENT_MUTEX
+extern int ring_buffer_put_wait(struct ring_buffer *rb, uint8_t c,
+		unsigned ms);
+extern int ring_buffer_get_wait(struct ring_buffer *rb, unsigned ms);
+
+/**
+ * @brief Wake up the thread waiting on a ring buffer.
+ * @param rb Ring buffer.
+ * @note Can only be called from IRQ context.
+ */
+static inline void ring_buffer_wake_irq(struct ring_buffer *rb)
+{
+	event_notify_irq(&rb->wq);
+}
+
+/**
+ * @brief Wake up the thread waiting on a ring buffer.
+ * @param rb Ring buffer.
+ */
+static inline void ring_buffer_wake(struct ring_buffer *rb)
+{
+	event_notify(&rb->wq);
+}
+#endif
+CDECL_END
+
+#endif /* __RINGBUFFER_H__ */
+
+/** @} */
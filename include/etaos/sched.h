@@ -69,6 +69,15 @@ struct sched_class {
 	 * switch has been done.
 	 */
 	void (*post_schedule)(struct rq*);
+	/**
+	 * @brief Put back the thread that lost the CPU.
+	 * @param rq Run queue \p tp is on.
+	 * @param tp Thread that is about to lose the CPU.
+	 *
+	 * This function pointer, if present, is called before the time
+	 * slice of \p tp is reset.
+	 */
+	void (*put_prev)(struct rq *rq, struct thread *tp);
 #ifdef CONFIG_DYN_PRIO
 	/**
 	 * @brief update the dynamic priority of all threads on the given rq.
@@ -123,6 +132,16 @@ struct sched_class {
 	 */
 	void (*queue_rm)(struct thread_queue *q, struct thread *tp);
 #endif
+#ifdef CONFIG_MUTEX_PI
+	/**
+	 * @brief Notify the class of a priority change.
+	 * @param rq Run queue \p tp is on.
+	 * @param tp Thread which priority is about to change.
+	 * @note \p tp has been removed from \p rq and will be added again
+	 *       after its priority has been changed.
+	 */
+	void (*prio_changed)(struct rq *rq, struct thread *tp);
+#endif
 #ifdef CONFIG_SCHED_DBG
 	/**
 	 * @brief Print run queue information.
@@ -145,6 +164,27 @@ struct sched_class {
 		__DEFINE_RQ,				\
 	}
 
+#ifdef CONFIG_RR_PRIO_BITMAP
+#define RR_PRIO_LEVELS (256 >> CONFIG_RR_PRIO_SHIFT) //!< Number of levels.
+/** @brief Number of words in the priority bitmap. */
+#define RR_PRIO_WORDS ((RR_PRIO_LEVELS + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+/**
+ * @brief Convert a thread priority into a priority bitmap level.
+ * @param __p Priority to convert.
+ */
+#define rr_prio_to_level(__p) ((__p) >> CONFIG_RR_PRIO_SHIFT)
+
+/**
+ * @struct rr_prio_level
+ * @brief List of threads sharing a priority level.
+ */
+struct rr_prio_level {
+	struct thread *head; //!< First thread on this level.
+	struct thread *tail; //!< Last thread on this level.
+};
+#endif
+
 /**
  * @struct rr_rq
  * @brief Round robin run queue.
@@ -152,8 +192,53 @@ struct sched_class {
 struct rr_rq {
 	/** @brief Run queue head. */
 	struct thread *run_queue;
+#ifdef CONFIG_RR_PRIO_BITMAP
+	/** @brief Bitmap of non-empty priority levels. */
+	unsigned long bitmap[RR_PRIO_WORDS];
+	/** @brief Per priority level thread lists. */
+	struct rr_prio_level levels[RR_PRIO_LEVELS];
+#endif
 };
 
+#ifdef CONFIG_EDF
+/**
+ * @struct edf_rq
+ * @brief EDF run queue.
+ *
+ * Binary min-heap of threads, ordered by their absolute deadline. The
+ * thread with the earliest deadline is stored in edf_rq::heap[0].
+ */
+struct edf_rq {
+	/** @brief Heap array. */
+	struct thread *heap[CONFIG_EDF_RQ_SIZE];
+	/** @brief Number of threads in edf_rq::heap. */
+	unsigned char num;
+};
+#endif
+
+#ifdef CONFIG_LOTTERY
+/**
+ * @struct lottery_rq
+ * @brief Lottery run queue.
+ *
+ * Runnable threads are stored in consecutive slots. The ticket counts of
+ * the slots are kept in a Fenwick tree, which allows a winning ticket to be
+ * mapped to its thread in O(log n) time.
+ */
+struct lottery_rq {
+	/** @brief Threads on the run queue. */
+	struct thread *slots[CONFIG_LOTTERY_RQ_SIZE];
+	/** @brief Fenwick tree of ticket counts (1-based). */
+	unsigned long tree[CONFIG_LOTTERY_RQ_SIZE + 1];
+	/** @brief Total number of tickets on the run queue. */
+	unsigned long total;
+	/** @brief Number of threads in lottery_rq::slots. */
+	unsigned char num;
+	/** @brief Tick at which the running thread received the CPU. */
+	unsigned long stamp;
+};
+#endif
+
 /**
  * @struct rq etaos/sched.h
  * @brief Run queue descriptor.
@@ -168,6 +253,14 @@ struct rq {
 #if defined(CONFIG_RR) || defined(CONFIG_FIFO) || defined(CONFIG_LOTTERY)
 	/** @brief Round robin run queue */
 	struct rr_rq rr_rq;
+#endif
+#ifdef CONFIG_EDF
+	/** @brief EDF run queue */
+	struct edf_rq edf_rq;
+#endif
+#ifdef CONFIG_LOTTERY
+	/** @brief Lottery run queue */
+	struct lottery_rq lottery_rq;
 #endif
 	/** @brief Number of threads in the run queue */
 	unsigned long num;
@@ -203,9 +296,63 @@ struct rq {
 #define sched_need_resched(__t) test_bit(THREAD_NEED_RESCHED_FLAG, \
 				&__t->flags)
 
+#ifdef CONFIG_SCHED_STATS
+/**
+ * @brief Global scheduling statistics.
+ * @see thread_stats
+ */
+struct sched_stats {
+	unsigned long switches; //!< Number of context switches.
+	unsigned long schedules; //!< Number of measured __schedule calls.
+	unsigned long irq_off_max; //!< Maximum IRQ off time in __schedule.
+	unsigned long irq_off_total; //!< Total IRQ off time in __schedule.
+};
+#endif
+
 CDECL
 
-#if defined(CONFIG_RR) || defined(CONFIG_FIFO) || defined(CONFIG_LOTTERY)
+#if defined(CONFIG_SYS_EDF)
+/**
+ * @brief Get the run queue head.
+ * @param rq Run queue to get the head for.
+ * @return The thread with the earliest deadline.
+ */
+static inline struct thread *rq_get_head(struct rq *rq)
+{
+	return rq->edf_rq.num ? rq->edf_rq.heap[0] : NULL;
+}
+#elif defined(CONFIG_SYS_LOTTERY)
+/**
+ * @brief Get the run queue head.
+ * @param rq Run queue to get the head for.
+ * @return The thread in the first lottery slot.
+ */
+static inline struct thread *rq_get_head(struct rq *rq)
+{
+	return rq->lottery_rq.num ? rq->lottery_rq.slots[0] : NULL;
+}
+#elif defined(CONFIG_RR) || defined(CONFIG_FIFO) || defined(CONFIG_LOTTERY)
+#ifdef CONFIG_RR_PRIO_BITMAP
+/**
+ * @brief Get the run queue head.
+ * @param rq Run queue to get the head for.
+ * @return The first thread on the highest non-empty priority level.
+ */
+static inline struct thread *rq_get_head(struct rq *rq)
+{
+	unsigned int idx;
+	unsigned long word;
+
+	for(idx = 0; idx < RR_PRIO_WORDS; idx++) {
+		word = rq->rr_rq.bitmap[idx];
+		if(word)
+			return rq->rr_rq.levels[idx * BITS_PER_LONG +
+				ffs_long(word) - 1].head;
+	}
+
+	return NULL;
+}
+#else
 /**
  * @brief Get the run queue head.
  * @param rq Run queue to get the head for.
@@ -216,8 +363,12 @@ static inline struct thread *rq_get_head(struct rq *rq)
 	return rq->rr_rq.run_queue;
 }
 #endif
+#endif
 
 extern unsigned char prio(struct thread *tp);
+#ifdef CONFIG_MUTEX_PI
+extern void sched_set_prio(struct thread *tp, unsigned char new_prio);
+#endif
 extern void schedule(void);
 extern bool should_resched(void);
 
@@ -290,6 +441,7 @@ extern void sched_create_stack_frame(struct thread *tp, stack_t *stack,
  */
 extern void sched_free_stack_frame(struct thread *tp);
 
+extern void raw_sched_kick_idle(struct rq *rq);
 extern void raw_thread_add_to_wake_q(struct thread *tp);
 extern void raw_thread_add_to_kill_q(struct thread *tp);
 extern void thread_add_to_wake_q(struct thread *tp);
@@ -308,6 +460,8 @@ extern struct thread *sched_find_thread_by_name(const char *name);
 
 extern void sched_mark_remote_kill(struct thread *tp);
 extern void sched_setup_sleep_thread(struct thread *tp, unsigned ms);
+extern struct timer *sched_arm_thread_timer(struct thread *tp, unsigned ms,
+		void (*handle)(struct timer*,void*), void *arg);
 extern void sched_yield(struct rq *rq);
 extern void sched_start(void);
 extern void current_thread_nolock(void);
@@ -341,6 +495,87 @@ extern void raw_queue_remove_thread(struct thread_queue *qp, struct thread *tp);
 extern void raw_queue_add_thread(struct thread_queue *qp, struct thread *tp);
 #endif
 
+#ifdef CONFIG_EDF
+extern int edf_set_params(struct thread *tp, unsigned long period,
+		unsigned long deadline, unsigned long wcet);
+extern void edf_wait_period(void);
+extern unsigned long edf_deadline_misses(struct thread *tp);
+#endif
+
+#ifdef CONFIG_LOTTERY
+extern int lottery_set_tickets(struct thread *tp, unsigned short tickets);
+extern void lottery_set_compensation(struct thread *tp, bool enable);
+extern unsigned short lottery_transfer_tickets(struct thread *from,
+		struct thread *to, unsigned short num);
+#endif
+
+#if defined(CONFIG_SYS_EDF) && defined(CONFIG_PREEMPT)
+extern bool edf_charge_budget(struct thread *tp, int ms);
+#else
+static inline bool edf_charge_budget(struct thread *tp, int ms)
+{
+	return false;
+}
+#endif
+
+#ifdef CONFIG_THREAD_LIST
+extern struct list_head thread_list;
+extern void thread_list_add(struct thread *tp);
+extern void thread_list_del(struct thread *tp);
+#else
+static inline void thread_list_add(struct thread *tp)
+{
+}
+
+static inline void thread_list_del(struct thread *tp)
+{
+}
+#endif
+
+#ifdef CONFIG_STACK_WATERMARK
+extern void sched_stack_scan_idle(void);
+#else
+static inline void sched_stack_scan_idle(void)
+{
+}
+#endif
+
+#ifdef CONFIG_STACK_CANARY
+extern void raw_sched_stack_check(struct thread *tp);
+#else
+static inline void raw_sched_stack_check(struct thread *tp)
+{
+}
+#endif
+
+#ifdef CONFIG_SCHED_STATS
+extern tick_t sched_stats_clock(void);
+extern void raw_sched_stats_wakeup(struct thread *tp);
+extern void raw_sched_stats_switch(struct thread *prev, struct thread *next);
+extern void raw_sched_stats_enter(void);
+extern void raw_sched_stats_exit(void);
+extern void sched_get_stats(struct sched_stats *stats);
+extern int sched_get_thread_stats(struct thread *tp,
+		struct thread_stats *stats);
+#else
+static inline void raw_sched_stats_wakeup(struct thread *tp)
+{
+}
+
+static inline void raw_sched_stats_switch(struct thread *prev,
+		struct thread *next)
+{
+}
+
+static inline void raw_sched_stats_enter(void)
+{
+}
+
+static inline void raw_sched_stats_exit(void)
+{
+}
+#endif
+
 #if defined(CONFIG_SCHED_FAIR) || defined(CONFIG_PREEMPT)
 extern void sched_clock_tick(int ms);
 #else
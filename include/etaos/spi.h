@@ -28,10 +28,23 @@
 #include <etaos/kernel.h>
 #include <etaos/error.h>
 #include <etaos/mem.h>
+#include <etaos/mempool.h>
 #include <etaos/device.h>
 #include <etaos/mutex.h>
+#include <etaos/list.h>
+#include <etaos/spinlock.h>
+#include <etaos/string.h>
 
 struct spidev;
+struct spi_msg;
+
+/**
+ * @brief SPI transfer completion callback.
+ * @param msg Message (batch) that has been transferred.
+ * @param arg Argument passed to spi_submit.
+ * @see spi_submit
+ */
+typedef void (*spi_complete_t)(struct spi_msg *msg, void *arg);
 
 /**
  * @brief SPI control options (commands).
@@ -43,17 +56,37 @@ typedef enum spi_ctrl {
 	SPI_MODE3, //!< CPOL:1 CPHA:1
 	SPI_SET_SPEED, //!< Set the SPI bitrate.
 	SPI_2X, //!< Enable SPI double bitrate (if supported).
+	SPI_ABORT, //!< Abort the transfer in progress.
 } spi_ctrl_t;
 
 /**
  * @brief SPI transmission message structure.
  * @note spi_msg::rx and spi_msg::tx can point to the same buffer. In this
  *       case data will be over written after the write operation.
+ *
+ * Messages can be chained using spi_msg::next into a batch. The chip select
+ * line stays asserted while the messages of a batch are transferred, so a
+ * batch can be used as a scatter-gather list: i.e. a command header followed
+ * by the data buffer of the caller. When spi_msg::tx is \p NULL, dummy bytes
+ * (0xFF) are sent. When spi_msg::rx is \p NULL, received data is dropped.
  */
 struct spi_msg {
 	void *rx; //!< Receive buffer.
-	void *tx; //!< Transmission buffer.
+	const void *tx; //!< Transmission buffer.
 	size_t len; //!< Length of rx and tx.
+	struct spi_msg *next; //!< Next message in the batch.
+
+	struct list_head entry; //!< Transfer queue entry.
+	struct spidev *dev; //!< Device the batch is transferred to.
+	spi_complete_t complete; //!< Completion callback.
+	void *arg; //!< Argument to spi_msg::complete.
+	/**
+	 * @brief Result of the batch.
+	 *
+	 * Amount of bytes transferred or an error code. Only valid in the
+	 * first message of a batch, after the batch has completed.
+	 */
+	int status;
 };
 
 /**
@@ -70,13 +103,30 @@ struct spi_driver {
 	struct gpio_pin *mosi, //!< Master Output Slave Input
 			*miso, //!< Master Input Slave Output
 			*clk; //!< Serial clock.
+
+	struct list_head queue; //!< Queued message batches.
+	struct spi_msg *cur; //!< Batch being transferred.
+	struct spi_msg *xfer; //!< Message being transferred.
+	bool paused; //!< Don't start new batches (bus is being configured).
+	spinlock_t qlock; //!< Transfer queue lock.
+	struct thread_queue pause_wq; //!< Threads waiting to pause the bus.
+	struct thread_queue idle_wq; //!< Thread waiting for the bus to idle.
+
 	/**
 	 * @brief Start a new transmission.
 	 * @param spi SPI device driver starting the transmission.
 	 * @param msg Message to be transferred.
-	 * @return Amount of bytes transferred.
+	 * @param poll Whether \p msg may be transferred by polling the bus.
+	 *             Set to \p false when called from IRQ context.
+	 * @return An error code, or the amount of bytes transferred.
+	 * @retval -EOK if the transfer has been started. The bus driver
+	 *              calls spi_xfer_complete when it is done.
+	 * @retval -EAGAIN if the transfer should be retried.
+	 *
+	 * When the message has been transferred before returning (i.e. by
+	 * polling the bus), the amount of bytes transferred is returned.
 	 */
-	int (*transfer)(struct spidev *spi, struct spi_msg *msg);
+	int (*start)(struct spidev *spi, struct spi_msg *msg, bool poll);
 	/**
 	 * @brief Control the SPI bus.
 	 * @param spi Device changing control options.
@@ -115,6 +165,12 @@ struct spidev {
 #define SPI_MODE3_MASK ((1<<SPI_CPOL_FLAG) | (1<<SPI_CPHA_FLAG))
 };
 
+#ifdef CONFIG_SPI_MSG_POOL
+CDECL
+extern struct mem_pool spi_msg_pool;
+CDECL_END
+#endif
+
 /**
  * @brief Allocate a new SPI message.
  * @param rx Receive buffer.
@@ -122,11 +178,20 @@ struct spidev {
  * @param len Length of \p rx and \p tx.
  * @return The allocated SPI message.
  */
-static inline struct spi_msg *spi_alloc_msg(void *rx, void *tx, size_t len)
+static inline struct spi_msg *spi_alloc_msg(void *rx, const void *tx,
+		size_t len)
 {
 	struct spi_msg *msg;
 
-	if((msg = kzalloc(sizeof(*msg))) == NULL)
+#ifdef CONFIG_SPI_MSG_POOL
+	msg = mem_pool_zalloc(&spi_msg_pool);
+	if(!msg)
+		msg = kzalloc(sizeof(*msg));
+#else
+	msg = kzalloc(sizeof(*msg));
+#endif
+
+	if(!msg)
 		return NULL;
 
 	msg->rx = rx;
@@ -135,6 +200,22 @@ static inline struct spi_msg *spi_alloc_msg(void *rx, void *tx, size_t len)
 	return msg;
 }
 
+/**
+ * @brief Initialise an SPI message.
+ * @param msg Message to initialise.
+ * @param rx Receive buffer.
+ * @param tx Transmit buffer.
+ * @param len Length of \p rx and \p tx.
+ */
+static inline void spi_msg_init(struct spi_msg *msg, void *rx,
+		const void *tx, size_t len)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->rx = rx;
+	msg->tx = tx;
+	msg->len = len;
+}
+
 /**
  * @brief Free a SPI message.
  * @param msg Message which has to be free'd.
@@ -142,6 +223,11 @@ static inline struct spi_msg *spi_alloc_msg(void *rx, void *tx, size_t len)
  */
 static inline void spi_free_msg(struct spi_msg *msg)
 {
+#ifdef CONFIG_SPI_MSG_POOL
+	if(mem_pool_free(&spi_msg_pool, msg) == -EOK)
+		return;
+#endif
+
 	kfree(msg);
 }
 
@@ -152,6 +238,9 @@ extern void spi_add_device(struct spi_driver *driver, struct spidev *dev);
 extern int spi_set_speed(struct spidev *dev, uint32_t bps);
 extern int spi_enable_2x(struct spidev *dev);
 extern int spi_transfer(struct spidev *dev, struct spi_msg *msg);
+extern int spi_submit(struct spidev *dev, struct spi_msg *msg,
+		spi_complete_t complete, void *arg);
+extern void spi_xfer_complete(struct spi_driver *master, int rv);
 extern int spi_set_mode(struct spidev *dev, spi_ctrl_t mode);
 CDECL_END
 
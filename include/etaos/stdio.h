@@ -192,8 +192,8 @@ extern int fprintf_P(struct file *stream, const char *fmt, ...);
 extern int vfprintf_P(struct file * stream, const char *fmt, va_list ap);
 #else
 #define puts_P(__str__) puts(__str__)
-#define printf_P(__fmt, args...) printf(__fmt, args)
-#define fprintf_P(__iostream, __fmt, args...) fprintf(__iostream, __fmt, args)
+#define printf_P(__fmt, args...) printf(__fmt, ##args)
+#define fprintf_P(__iostream, __fmt, args...) fprintf(__iostream, __fmt, ##args)
 #define vfprintf_P(__iostream, __fmt, __ap) vfprintf(__iostream, __fmt, __ap)
 #endif
 
@@ -30,6 +30,7 @@
 
 #include <etaos/kernel.h>
 #include <etaos/thread.h>
+#include <etaos/sched.h>
 
 /**
  * @brief Utility class for system pheripherals.
@@ -46,6 +47,10 @@ public:
 	static void wait(void);
 	static void signal(struct thread *tp);
 	static time_t time(void);
+#ifdef CONFIG_SCHED_STATS
+	static void stats(struct sched_stats *stats);
+	static int stats(struct thread *tp, struct thread_stats *stats);
+#endif
 
 private:
 	Kernel() {}
@@ -27,6 +27,7 @@
 #include <etaos/types.h>
 #include <etaos/spinlock.h>
 #include <etaos/list.h>
+#include <etaos/timer.h>
 
 /**
  * @addtogroup thread
@@ -85,11 +86,8 @@ typedef void (*thread_handle_t)(void *arg);
 static void fn(void * param); \
 static void fn(void *param)
 
-#ifdef CONFIG_LOTTERY
-struct lottery_ticket {
-	struct list_head list;
-	unsigned short ticket;
-};
+#ifdef CONFIG_MUTEX_PI
+struct mutex;
 #endif
 
 /**
@@ -98,11 +96,26 @@ struct lottery_ticket {
  */
 struct rr_entity {
 	struct thread *next; //!< List entry pointer.
+#ifdef CONFIG_RR_PRIO_BITMAP
+	struct thread *prev; //!< Previous pointer on the priority level list.
+	unsigned char level; //!< Run queue priority level.
+#endif
 #ifdef CONFIG_LOTTERY
-	struct list_head tickets; //!< Lotery tickets.
+	unsigned short tickets; //!< Lottery tickets, 0 to derive from prio.
+	unsigned short comp; //!< Compensation tickets.
+	unsigned short weight; //!< Tickets held in the lottery run queue.
+	bool comp_enable; //!< Compensation tickets enabled.
+	unsigned char slot; //!< Lottery run queue slot.
 #endif
 #ifdef CONFIG_EDF
 	time_t deadline; //!< EDF deadline timestamp.
+	time_t release; //!< Release time of the current period.
+	unsigned long period; //!< Period in miliseconds, 0 if aperiodic.
+	unsigned long rel_deadline; //!< Relative deadline in miliseconds.
+	unsigned long wcet; //!< Execution budget per period in miliseconds.
+	unsigned long budget; //!< Budget left in the current period.
+	unsigned long misses; //!< Number of missed deadlines.
+	unsigned char heap_idx; //!< Index in the EDF run queue heap.
 #endif
 };
 
@@ -135,8 +148,37 @@ struct stack_info {
 #ifdef CONFIG_STACK_TRACE_LENGTH
 	size_t max_length; //!< Maximum stack usage.
 #endif
+#ifdef CONFIG_STACK_WATERMARK
+	size_t high_water; //!< Peak stack usage found by the stack scanner.
+#endif
 };
 
+#ifdef CONFIG_STACK_WATERMARK
+#define STACK_PAINT_BYTE 0xA5 //!< Pattern of unused stack bytes.
+#define STACK_CANARY_SIZE 4 //!< Number of bytes checked for stack overflows.
+#endif
+
+#ifdef CONFIG_SCHED_STATS
+/**
+ * @brief Per thread scheduling statistics.
+ *
+ * Time is measured in cycles of the high resolution clock when it is
+ * available, in system ticks otherwise.
+ * @see arch_hrtimer_cycles
+ */
+struct thread_stats {
+	tick_t runtime; //!< CPU time used.
+	tick_t last_run; //!< Time stamp of the last switch to the thread.
+	tick_t woken; //!< Time stamp of the last wake up, 0 when running.
+	unsigned long nvcsw; //!< Number of voluntary context switches.
+	unsigned long nivcsw; //!< Number of involuntary context switches.
+	unsigned long wakeups; //!< Number of measured wake up latencies.
+	unsigned long lat_min; //!< Minimum wake up to run latency.
+	unsigned long lat_max; //!< Maximum wake up to run latency.
+	unsigned long lat_total; //!< Sum of all wake up to run latencies.
+};
+#endif
+
 struct rq;
 /**
  * @struct thread
@@ -164,13 +206,25 @@ struct thread {
 #ifdef CONFIG_SCHED_FAIR
 	time_t cputime; //!< Total CPU time.
 #endif
+#ifdef CONFIG_SCHED_STATS
+	struct thread_stats stats; //!< Scheduling statistics.
+#endif
+#ifdef CONFIG_THREAD_LIST
+	struct list_head thread_entry; //!< Entry in the list of all threads.
+#endif
 
 	struct stack_info stack;
 	unsigned char prio; //!< Thread priority.
 #ifdef CONFIG_DYN_PRIO
 	unsigned char dprio; //!< Dynamic thread priority.
+#endif
+#ifdef CONFIG_MUTEX_PI
+	unsigned char base_prio; //!< Priority without inherited boosts.
+	unsigned char pi_held; //!< Number of PI mutexes held.
+	struct mutex *pi_blocked_on; //!< PI mutex the thread is waiting for.
 #endif
 	struct timer *timer; //!< Event timer.
+	struct timer tmo; //!< Embedded sleep / timeout timer.
 
 #ifdef CONFIG_EVENT_MUTEX
 	unsigned char ec; //!< Event counter.
@@ -193,6 +247,11 @@ typedef struct thread_attr {
 	size_t stack_size; //!< Size of the stack.
 	void *stack; //!< Stack base pointer.
 	unsigned char prio; //!< Thread priority.
+#ifdef CONFIG_EDF
+	unsigned long period; //!< EDF period in miliseconds (0 if aperiodic).
+	unsigned long deadline; //!< EDF relative deadline in miliseconds.
+	unsigned long wcet; //!< EDF execution budget per period.
+#endif
 } thread_attr_t;
 
 /**
@@ -222,6 +281,10 @@ typedef struct thread_attr {
 /** @} */
 
 CDECL
+#ifdef CONFIG_THREAD_POOL
+extern struct mem_pool thread_pool;
+#endif
+
 extern int thread_initialise(struct thread *tp, const char *name,
 		thread_handle_t handle, void *arg, size_t stack_size,
 		void *stack, unsigned char prio);
@@ -274,6 +337,15 @@ static inline float thread_max_relative_stack_length(struct thread *tp)
 }
 #endif
 
+#ifdef CONFIG_STACK_WATERMARK
+extern size_t thread_stack_high_water(struct thread *tp);
+#else
+static inline size_t thread_stack_high_water(struct thread *tp)
+{
+	return 0UL;
+}
+#endif
+
 extern struct thread *current_thread();
 
 extern int thread_destroy(struct thread *tp);
@@ -43,6 +43,34 @@ CDECL
 extern void systick_setup(int irq, struct clocksource *src);
 extern struct clocksource *sys_clk;
 
+#ifdef CONFIG_NO_HZ_IDLE
+/**
+ * @ingroup archAPI
+ * @brief Stop the periodic system tick.
+ * @param ticks Maximum number of ticks to skip.
+ * @return The number of ticks after which the next tick IRQ will fire.
+ * @retval 0 if the tick could not be stopped.
+ * @note This function is called with interrupts disabled.
+ */
+extern unsigned long arch_tick_suspend(unsigned long ticks);
+/**
+ * @ingroup archAPI
+ * @brief Restart the periodic system tick.
+ * @param expired Indicates whether the tick IRQ has fired.
+ * @return The number of ticks that have passed since arch_tick_suspend.
+ * @note This function is called with interrupts disabled.
+ */
+extern unsigned long arch_tick_resume(bool expired);
+
+extern bool tick_nohz_irq(void);
+extern void tick_nohz_idle(struct clocksource *cs);
+#else
+static inline bool tick_nohz_irq(void)
+{
+	return false;
+}
+#endif
+
 /**
  * @brief Get the system tick in seconds.
  * @return The system tick in seconds.
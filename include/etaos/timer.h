@@ -50,6 +50,7 @@ struct timer {
 	void *priv_data; //!< Private timer data.
 	time_t expire_at; //!< Expiry time stamp.
 	unsigned int interval; //!< Timer interval.
+	unsigned long flags; //!< Timer flags.
 };
 
 /**
@@ -67,6 +68,15 @@ struct timer {
  */
 #define TIMER_ONESHOT_MASK (1<<TIMER_ONESHOT_FLAG)
 
+/**
+ * @def TIMER_STATIC_FLAG
+ * @brief Timer is statically allocated.
+ *
+ * Static timers are initialised using timer_init_static and are never
+ * freed by the timer core.
+ */
+#define TIMER_STATIC_FLAG 1
+
 /**
  * @def cs_last_update
  * @brief Get the system tick of the last moment \p __cs was updated.
@@ -86,6 +96,26 @@ static inline void timer_source_inc(struct clocksource *cs)
 	cs->count += 1ULL;
 }
 
+/**
+ * @brief Add a number of ticks to the tick count of a clock source.
+ * @param cs Clock source which tick count is to be incremented.
+ * @param ticks Number of ticks to add.
+ */
+static inline void timer_source_add(struct clocksource *cs, unsigned long ticks)
+{
+	cs->count += ticks;
+}
+
+/**
+ * @brief Check if a timer is armed.
+ * @param timer Timer to check.
+ * @return True if \p timer is on its clocksource, false otherwise.
+ */
+static inline bool timer_is_armed(struct timer *timer)
+{
+	return timer->entry.next != NULL;
+}
+
 extern struct clocksource *timer_get_source_by_name(const char *name);
 
 extern void timer_process(struct clocksource *cs);
@@ -94,6 +124,21 @@ extern struct timer *timer_create(struct clocksource *cs, unsigned long ms,
 		unsigned long flags);
 extern int timer_stop(struct timer *timer);
 extern int raw_timer_stop(struct timer *timer);
+extern void timer_init_static(struct timer *timer, struct clocksource *cs,
+		void (*handle)(struct timer*,void*), void *arg,
+		unsigned long flags);
+extern int timer_arm(struct timer *timer, unsigned long ms);
+extern int timer_disarm(struct timer *timer);
+extern time_t timer_next_expiry(struct clocksource *cs);
+
+#ifdef CONFIG_TIMER_WHEEL
+extern int timer_wheel_init(struct clocksource *cs);
+extern void raw_timer_wheel_insert(struct clocksource *cs, struct timer *timer);
+extern int raw_timer_wheel_remove(struct clocksource *cs, struct timer *timer);
+extern struct timer *raw_timer_wheel_next_expired(struct clocksource *cs,
+		tick_t now);
+extern time_t raw_timer_wheel_next_expiry(struct clocksource *cs);
+#endif
 
 CDECL_END
 
@@ -32,6 +32,31 @@
 #include <etaos/types.h>
 #include <etaos/device.h>
 #include <etaos/mutex.h>
+#include <etaos/spinlock.h>
+
+struct ring_buffer;
+
+/**
+ * @brief USART `ioctl()` options.
+ */
+typedef enum {
+	USART_SET_READ_MODE, //!< Set the read mode, see usart_read_mode_t.
+	USART_SET_RX_TIMEOUT, //!< Set the read timeout in miliseconds.
+	USART_SET_DELIMITER, //!< Set the delimiter of USART_READ_DELIM.
+	USART_GET_RX_COUNT, //!< Get the number of buffered bytes.
+	USART_FLUSH_RX, //!< Discard all buffered bytes.
+} usart_ioctl_t;
+
+/**
+ * @brief USART read modes.
+ */
+typedef enum {
+	USART_READ_FILL, //!< Read until the buffer is full.
+	USART_READ_DELIM, //!< Read until the delimiter has been received.
+	USART_READ_SOME, //!< Read what is available, wait for at least 1 byte.
+} usart_read_mode_t;
+
+#define USART_NONBLOCK -1 //!< Timeout value for non blocking reads.
 
 /**
  * @struct usart
@@ -41,6 +66,24 @@ struct usart {
 	int timeout; //!< Transmission timeout.
 	mutex_t rx, tx;
 
+	struct ring_buffer *rxbuf; //!< RX buffer filled by the driver.
+	/**
+	 * @brief Protects the read settings.
+	 *
+	 * The settings can be changed while a reader holds usart::rx. They
+	 * are applied by the next read.
+	 */
+	spinlock_t cfg;
+	usart_read_mode_t read_mode; //!< Read mode.
+	int delim; //!< Delimiter used by USART_READ_DELIM.
+	/**
+	 * @brief Read timeout in miliseconds.
+	 *
+	 * A read ends when no data has been received for this long. A value
+	 * of 0 waits forever and USART_NONBLOCK doesn't wait at all.
+	 */
+	int rx_timeout;
+
 	struct device dev; //!< Backend USART device.
 	/**
 	 * @brief Write to the USART device.
@@ -68,7 +111,7 @@ struct usart {
 	 * @brief Read from a USART device.
 	 * @param rx RX buffer.
 	 * @param len Length of \p rx.
-	 * @return Error code.
+	 * @return The number of bytes read or an error code.
 	 */
 	int (*read)(struct usart *uart, void *rx, size_t len);
 };
@@ -78,6 +121,11 @@ CDECL
 extern int usart_initialise(struct usart *usart);
 extern void setup_usart_streams(struct usart *uart);
 
+#ifdef CONFIG_RING_BUFFER
+extern int usart_rx_getc(struct usart *usart);
+extern int usart_rx_read(struct usart *usart, void *rx, size_t len);
+#endif
+
 CDECL_END
 
 #endif
@@ -0,0 +1,92 @@
+/*
+ *  ETA/OS - Work queues
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file etaos/workqueue.h */
+
+#ifndef __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+/**
+ * @addtogroup workqueue
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/timer.h>
+
+struct work;
+
+/**
+ * @brief Work handler.
+ * @param work Work item that is being processed.
+ * @param arg Argument given to work_init.
+ */
+typedef void (*work_handle_t)(struct work *work, void *arg);
+
+/**
+ * @brief Deferred work item.
+ *
+ * Work items are processed by a small pool of shared worker threads. Each
+ * worker runs at a fixed priority; the work level selects the worker.
+ */
+struct work {
+	struct work *next; //!< Next work item of the worker.
+	work_handle_t handle; //!< Work handler.
+	void *arg; //!< Argument to struct work::handle.
+	unsigned char level; //!< Worker level, see WORK_HIGH_PRIO.
+	bool pending; //!< True if the work item is queued.
+};
+
+/**
+ * @brief Deferred work item with a delay.
+ */
+struct delayed_work {
+	struct work work; //!< Work item.
+	struct timer timer; //!< Delay timer.
+};
+
+#define WORK_HIGH_PRIO 0 //!< Level of the highest priority worker.
+/**
+ * @brief Level of the lowest priority worker.
+ */
+#define WORK_LOW_PRIO (CONFIG_WORKQUEUE_WORKERS - 1)
+
+CDECL
+extern void work_init(struct work *work, work_handle_t handle, void *arg,
+		unsigned char level);
+extern void delayed_work_init(struct delayed_work *dwork,
+		work_handle_t handle, void *arg, unsigned char level);
+extern int queue_work(struct work *work);
+extern int queue_delayed_work(struct delayed_work *dwork, unsigned ms);
+extern int cancel_work(struct work *work);
+extern int cancel_delayed_work(struct delayed_work *dwork);
+
+/**
+ * @brief Check if a work item is queued.
+ * @param work Work item to check.
+ * @return True if \p work is waiting to be processed.
+ */
+static inline bool work_pending(struct work *work)
+{
+	return work->pending;
+}
+CDECL_END
+
+/** @} */
+#endif
@@ -0,0 +1,96 @@
+/*
+ *  ETA/OS - External memory manager
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file etaos/xmem.h
+ */
+
+/**
+ * @addtogroup xmem
+ * @{
+ */
+
+#ifndef __XMEM_H__
+#define __XMEM_H__
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/mutex.h>
+#include <etaos/device.h>
+#include <etaos/sram.h>
+
+/**
+ * @brief External memory handle.
+ *
+ * A handle is the address of the allocated memory on the SRAM chip.
+ * XMEM_NULL is never a valid handle.
+ */
+typedef size_t xmem_t;
+
+#define XMEM_NULL 0 //!< Invalid handle.
+#define XMEM_LINE_SIZE 64 //!< Size of a cache line.
+
+/**
+ * @brief External memory cache line.
+ */
+struct xmem_line {
+	xmem_t addr; //!< Address of the cached memory.
+	unsigned long stamp; //!< Time of the last access.
+	unsigned long flags; //!< Line flags.
+	uint8_t pins; //!< Pin count.
+	uint8_t data[XMEM_LINE_SIZE]; //!< Cached memory.
+/**
+ * @name Cache line flags
+ * @{
+ */
+#define XMEM_LINE_VALID 0 //!< Line contains cached memory.
+#define XMEM_LINE_DIRTY 1 //!< Line has to be written back.
+/** @} */
+};
+
+/**
+ * @brief External memory area.
+ */
+struct xmem {
+	struct device *dev; //!< SRAM device.
+	struct sram *ram; //!< SRAM chip.
+	xmem_t base; //!< First address of the area.
+	size_t blocks; //!< Number of allocation blocks.
+	uint8_t *map; //!< Allocation bitmap.
+	uint8_t *starts; //!< Bitmap of the first blocks of allocations.
+	unsigned long clock; //!< Cache access clock.
+	mutex_t lock; //!< Area lock.
+	struct xmem_line lines[CONFIG_XMEM_CACHE_LINES]; //!< Cache lines.
+};
+
+CDECL
+extern int xmem_init(struct xmem *xm, const char *name, xmem_t base,
+		size_t size);
+extern xmem_t xmem_alloc(struct xmem *xm, size_t size);
+extern void xmem_free(struct xmem *xm, xmem_t handle);
+extern int xmem_read(struct xmem *xm, xmem_t addr, void *buff, size_t len);
+extern int xmem_write(struct xmem *xm, xmem_t addr, const void *buff,
+		size_t len);
+extern void *xmem_pin(struct xmem *xm, xmem_t addr, size_t len);
+extern void xmem_unpin(struct xmem *xm, xmem_t addr, bool dirty);
+extern int xmem_flush(struct xmem *xm);
+CDECL_END
+
+#endif
+
+/** @} */
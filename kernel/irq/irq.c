@@ -31,6 +31,7 @@
 #include <etaos/mem.h>
 #include <etaos/thread.h>
 #include <etaos/gpio.h>
+#include <etaos/string.h>
 
 #include <asm/io.h>
 
@@ -103,6 +104,7 @@ static int irq_request_threaded_irq(struct irq_thread_data *data)
 	if(!stack)
 		return -ENOMEM;
 
+	memset(&attr, 0, sizeof(attr));
 	attr.prio = IRQ_THREAD_PRIO;
 	attr.stack = stack;
 	attr.stack_size = CONFIG_IRQ_STACK_SIZE;
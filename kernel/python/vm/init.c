@@ -68,6 +68,7 @@ int python_start(const char *modname)
 	thread_attr_t attribs;
 
 	strcpy(&pymodule[0], modname);
+	memset(&attribs, 0, sizeof(attribs));
 	attribs.stack = kzalloc(CONFIG_PYTHON_STACK_SIZE);
 	attribs.stack_size = CONFIG_PYTHON_STACK_SIZE;
 	attribs.prio = CONFIG_PYTHON_PRIO;
@@ -35,13 +35,16 @@
  * @note This function should not be called more than once per milisecond.
  *
  * Increment the time that the current thread has spent on the CPU by \p ms.
- * If the current threads time slice reaches 0, the thread will be setup
- * for preemption.
+ * If the current threads time slice or EDF budget reaches 0, the thread will be
+ * setup for preemption.
  */
 void sched_clock_tick(int ms)
 {
 	struct rq *rq;
 	struct thread *tp;
+#ifdef CONFIG_PREEMPT
+	bool resched;
+#endif
 
 	rq = sched_get_cpu_rq();
 	tp = rq->current;
@@ -51,8 +54,9 @@ void sched_clock_tick(int ms)
 #endif
 
 #ifdef CONFIG_PREEMPT
+	resched = edf_charge_budget(tp, ms);
 	tp->slice -= ms;
-	if(!tp->slice) {
+	if(!tp->slice || resched) {
 		tp->slice = CONFIG_TIME_SLICE;
 		set_bit(PREEMPT_NEED_RESCHED_FLAG, &tp->flags);
 		preempt_schedule_irq();
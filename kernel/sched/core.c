@@ -37,6 +37,7 @@
 #include <etaos/error.h>
 #include <etaos/string.h>
 #include <etaos/mem.h>
+#include <etaos/mempool.h>
 #include <etaos/thread.h>
 #include <etaos/sched.h>
 #include <etaos/event.h>
@@ -234,8 +235,8 @@ void thread_queue_wait(struct thread_queue *qp, unsigned int ms)
 {
 	struct thread *current = current_thread();
 
-	current->timer = timer_create(current->rq->source, ms, &queue_wait_tmo,
-			              current, TIMER_ONESHOT_MASK);
+	current->timer = sched_arm_thread_timer(current, ms, &queue_wait_tmo,
+						current);
 	queue_add_thread(qp, current);
 	schedule();
 }
@@ -488,9 +489,27 @@ static void raw_rq_add_thread(struct rq *rq, struct thread *tp)
 	struct sched_class *class = rq->sched_class;
 
 	class->add_thread(rq, tp);
+	raw_sched_stats_wakeup(tp);
 	set_bit(THREAD_RUNNING_FLAG, &tp->flags);
 	tp->on_rq = true;
 	tp->rq = rq;
+	raw_sched_kick_idle(rq);
+}
+
+/**
+ * @brief Make the idle thread run the scheduler before it sleeps.
+ * @param rq Run queue that has work to do.
+ * @note This function should be called with interrupts disabled.
+ *
+ * The idle thread checks its \p THREAD_NEED_RESCHED_FLAG with interrupts
+ * disabled before it puts the CPU to sleep.
+ */
+void raw_sched_kick_idle(struct rq *rq)
+{
+	struct thread *tp = rq->current;
+
+	if(tp && test_bit(THREAD_IDLE_FLAG, &tp->flags))
+		set_bit(THREAD_NEED_RESCHED_FLAG, &tp->flags);
 }
 
 /**
@@ -528,6 +547,7 @@ int rq_add_thread(struct rq *rq, struct thread *tp)
 
 	raw_spin_lock_irqsave(&rq->lock, flags);
 	class->add_thread(rq, tp);
+	raw_sched_stats_wakeup(tp);
 	set_bit(THREAD_RUNNING_FLAG, &tp->flags);
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 	tp->on_rq = true;
@@ -676,6 +696,35 @@ static void rq_update(struct rq *rq)
 	irq_restore(&tp->irq_state);
 }
 
+/**
+ * @brief Arm the embedded timeout timer of a thread.
+ * @param tp Thread to arm the timer of.
+ * @param ms Timeout in miliseconds.
+ * @param handle Timer handle.
+ * @param arg Argument to \p handle.
+ * @return The armed timer.
+ *
+ * Sleep and wait timeouts use the timer embedded in struct thread, so no
+ * memory has to be allocated (or freed) to put a thread to sleep. A timeout
+ * that can't be armed would leave \p tp waiting forever, so the kernel
+ * panics instead.
+ */
+struct timer *sched_arm_thread_timer(struct thread *tp, unsigned ms,
+		void (*handle)(struct timer*,void*), void *arg)
+{
+	struct timer *timer = &tp->tmo;
+
+	if(timer_is_armed(timer))
+		timer_disarm(timer);
+
+	timer_init_static(timer, tp->rq->source, handle, arg,
+			TIMER_ONESHOT_MASK);
+	if(unlikely(timer_arm(timer, ms) != -EOK))
+		panic("Failed to arm the timeout of %s!\n", tp->name);
+
+	return timer;
+}
+
 /**
  * @brief Timer handle for sleeping threads.
  * @param timer Timer pointer.
@@ -709,8 +758,7 @@ void sched_setup_sleep_thread(struct thread *tp, unsigned ms)
 	set_bit(THREAD_NEED_RESCHED_FLAG, &tp->flags);
 	clear_bit(THREAD_RUNNING_FLAG, &tp->flags);
 
-	tp->timer = timer_create(rq->source, ms, &sched_sleep_timeout,
-			         tp, TIMER_ONESHOT_MASK);
+	tp->timer = sched_arm_thread_timer(tp, ms, &sched_sleep_timeout, tp);
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
@@ -753,10 +801,17 @@ static void rq_destroy_kill_q(struct rq *rq)
 	list_for_each_safe(carriage, x, &rq->kill_head) {
 		walker = list_entry(carriage, struct thread, entry);
 		raw_rq_remove_kill_thread(rq, walker);
+		thread_list_del(walker);
+
+		if(timer_is_armed(&walker->tmo))
+			timer_disarm(&walker->tmo);
 
 		if(test_bit(THREAD_SYSTEM_STACK, &walker->flags))
 			sched_free_stack_frame(walker);
 
+#ifdef CONFIG_THREAD_POOL
+		mem_pool_free(&thread_pool, walker);
+#endif
 	}
 	raw_spin_unlock_irq(&rq->lock, &flags);
 }
@@ -1045,6 +1100,9 @@ static inline void __schedule_prepare(struct rq *rq,
 	dyn_prio_reset(prev);
 	dyn_prio_reset(next);
 
+	if(rq->sched_class->put_prev)
+		rq->sched_class->put_prev(rq, prev);
+
 	/*
 	 * Reset the time slices of the entering and leaving threads.
 	 */
@@ -1228,6 +1286,7 @@ static bool __sched__ __schedule(int cpu)
 	cpu_notify(SCHED_ENTER);
 	rq = cpu_to_rq(cpu);
 	raw_spin_lock_irq(&rq->lock, &flags);
+	raw_sched_stats_enter();
 	prev = current_thread();
 
 	/*
@@ -1251,10 +1310,14 @@ static bool __sched__ __schedule(int cpu)
 		rescheduled = true;
 
 		__schedule_prepare(rq, prev, next, flags);
+		raw_sched_stats_switch(prev, next);
+		raw_sched_stack_check(prev);
 		rq_switch_context(rq, prev, next);
+		raw_sched_stats_exit();
 		rq_update(rq); /* restores CPU / IRQ states */
 
 	} else {
+		raw_sched_stats_exit();
 		raw_spin_unlock_irq(&rq->lock, &flags);
 	}
 
@@ -1375,9 +1438,14 @@ THREAD(idle_thread_func, arg)
 	while(true) {
 		set_bit(THREAD_NEED_RESCHED_FLAG, &tp->flags);
 		schedule();
+		sched_stack_scan_idle();
 #ifdef CONFIG_IDLE_SLEEP
 		power_set_mode(POWER_IDLE);
+#ifdef CONFIG_NO_HZ_IDLE
+		tick_nohz_idle(tp->rq->source);
+#else
 		hibernate();
+#endif
 #endif
 	}
 }
@@ -1414,6 +1482,8 @@ static bool thread_is_idle(struct thread *tp)
 	return test_bit(THREAD_IDLE_FLAG, &tp->flags);
 }
 
+static int preempt_boot_cnt;
+
 /**
  * @brief Get a pointer to the preemption counter of the current thread.
  * @return A pointer to the preemption counter of the current thread.
@@ -1423,6 +1493,11 @@ static bool thread_is_idle(struct thread *tp)
 int *preempt_counter_ptr(void)
 {
 	struct thread *tp = current_thread();
+
+	/* The initialisation code runs before there is a current thread */
+	if(unlikely(!tp))
+		return &preempt_boot_cnt;
+
 	return &tp->preempt_cnt;
 }
 
@@ -1489,6 +1564,9 @@ bool preempt_should_resched(void)
 	struct thread *tp;
 
 	tp = current_thread();
+	if(unlikely(!tp))
+		return false;
+
 	return test_bit(PREEMPT_NEED_RESCHED_FLAG, &tp->flags) ||
 		should_resched();
 }
@@ -1508,6 +1586,10 @@ bool preempt_should_resched(void)
 bool should_resched(void)
 {
 	struct thread *tp = current_thread();
+
+	if(unlikely(!tp))
+		return false;
+
 	return test_bit(THREAD_NEED_RESCHED_FLAG, &tp->flags);
 }
 
@@ -1552,6 +1634,43 @@ unsigned char prio(struct thread *tp)
 }
 #endif
 
+#ifdef CONFIG_MUTEX_PI
+/**
+ * @brief Change the priority of a thread.
+ * @param tp Thread to change the priority of.
+ * @param new_prio New priority of \p tp.
+ *
+ * If \p tp is on a run queue, it is removed and added again so the
+ * scheduling class can take the new priority into account. Threads that
+ * are waiting pick up the new priority when they are woken up.
+ */
+void sched_set_prio(struct thread *tp, unsigned char new_prio)
+{
+	struct sched_class *class;
+	struct rq *rq;
+	unsigned long flags;
+
+	rq = tp->rq;
+	if(!rq || !tp->on_rq || !test_bit(THREAD_RUNNING_FLAG, &tp->flags)) {
+		tp->prio = new_prio;
+		return;
+	}
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	class = rq->sched_class;
+	if(class->rm_thread(rq, tp)) {
+		tp->prio = new_prio;
+	} else {
+		if(class->prio_changed)
+			class->prio_changed(rq, tp);
+
+		tp->prio = new_prio;
+		class->add_thread(rq, tp);
+	}
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+}
+#endif
+
 /**
  * @brief Initialise the scheduling core.
  * @note This function is automatically called during the sysinit.
@@ -26,6 +26,10 @@
 #include <etaos/error.h>
 #include <etaos/sched.h>
 #include <etaos/thread.h>
+#include <etaos/irq.h>
+#include <etaos/panic.h>
+#include <etaos/spinlock.h>
+#include <etaos/clocksource.h>
 
 #include <asm/pgm.h>
 #include <asm/io.h>
@@ -176,6 +180,76 @@ static time_t deadline(struct rr_entity *entity)
 	return entity->deadline;
 }
 
+/**
+ * @brief Get the current time of the scheduling clock.
+ * @return The current scheduling clock tick.
+ */
+static inline time_t edf_now(void)
+{
+	return (time_t)clocksource_get_tick(sched_get_clock());
+}
+
+/**
+ * @brief Start a new period.
+ * @param se Entity of a periodic thread.
+ * @param release Release time of the new period.
+ */
+static void edf_release(struct rr_entity *se, time_t release)
+{
+	se->release = release;
+	se->deadline = release + se->rel_deadline;
+	se->budget = se->wcet;
+}
+
+/**
+ * @brief Replenish the deadline of a periodic thread.
+ * @param se Entity of a periodic thread.
+ * @param now Current time.
+ *
+ * Each period that ended before the thread finished its work is counted
+ * as a deadline miss. The thread is moved to the period containing \p now.
+ * A deadline of 0 means the first period has not been released yet.
+ */
+static void edf_replenish(struct rr_entity *se, time_t now)
+{
+	unsigned long periods;
+
+	if(unlikely(!se->deadline)) {
+		edf_release(se, now);
+		return;
+	}
+
+	if(likely(se->deadline > now))
+		return;
+
+	periods = (unsigned long)((now - se->deadline) / se->period) + 1;
+	se->misses += periods;
+	edf_release(se, se->release + (time_t)periods * se->period);
+}
+
+/**
+ * @brief Update the deadline of a thread before it is queued.
+ * @param tp Thread to update.
+ *
+ * Aperiodic threads receive a virtual deadline based on their priority. The
+ * deadline of a periodic thread only changes when its period has ended.
+ */
+static void edf_update_deadline(struct thread *tp)
+{
+	struct rr_entity *se;
+
+	se = &tp->se;
+	if(se->period) {
+		edf_replenish(se, edf_now());
+		return;
+	}
+
+	se->deadline = edf_now() + edf_calc_ratio(prio(tp));
+
+	if(test_bit(THREAD_IDLE_FLAG, &tp->flags))
+		se->deadline += 15778463000000LL;
+}
+
 /**
  * @brief Insert a thread into a raw queue using EDF.
  * @param tpp Raw queue pointer to insert into.
@@ -186,20 +260,15 @@ static int raw_edf_insert(struct thread *volatile*tpp, struct thread *tp)
 {
 	struct thread *thread;
 	struct rr_entity *se;
-	struct clocksource *clock;
 
 #ifdef CONFIG_EVENT_MUTEX
 	tp->ec = 0;
 #endif
 
-	clock = sched_get_clock();
 	se = &tp->se;
 	tp->queue = tpp;
 	thread = *tpp;
-	se->deadline = clocksource_get_tick(clock) + edf_calc_ratio(prio(tp));
-
-	if(test_bit(THREAD_IDLE_FLAG, &tp->flags))
-		se->deadline += 15778463000000LL;
+	edf_update_deadline(tp);
 
 	if(unlikely(thread == SIGNALED)) {
 		thread = NULL;
@@ -227,6 +296,130 @@ static int raw_edf_insert(struct thread *volatile*tpp, struct thread *tp)
 	return -EOK;
 }
 
+/**
+ * @brief Check if a thread should run before another thread.
+ * @param a Thread to check.
+ * @param b Thread to check against.
+ * @return True if \p a should run before \p b.
+ *
+ * Ties between equal deadlines are broken using the thread priority.
+ */
+static inline bool edf_before(struct thread *a, struct thread *b)
+{
+	if(a->se.deadline != b->se.deadline)
+		return a->se.deadline < b->se.deadline;
+
+	return prio(a) < prio(b);
+}
+
+/**
+ * @brief Store a thread in a heap slot.
+ * @param edf EDF run queue.
+ * @param idx Heap index.
+ * @param tp Thread to store at \p idx.
+ */
+static inline void edf_heap_set(struct edf_rq *edf, unsigned int idx,
+		struct thread *tp)
+{
+	edf->heap[idx] = tp;
+	tp->se.heap_idx = idx;
+}
+
+/**
+ * @brief Move a thread up the heap.
+ * @param edf EDF run queue.
+ * @param idx Free slot to start from.
+ * @param tp Thread to place.
+ */
+static void edf_heap_up(struct edf_rq *edf, unsigned int idx,
+		struct thread *tp)
+{
+	unsigned int parent;
+
+	while(idx) {
+		parent = (idx - 1) / 2;
+		if(!edf_before(tp, edf->heap[parent]))
+			break;
+
+		edf_heap_set(edf, idx, edf->heap[parent]);
+		idx = parent;
+	}
+
+	edf_heap_set(edf, idx, tp);
+}
+
+/**
+ * @brief Move a thread down the heap.
+ * @param edf EDF run queue.
+ * @param idx Free slot to start from.
+ * @param tp Thread to place.
+ */
+static void edf_heap_down(struct edf_rq *edf, unsigned int idx,
+		struct thread *tp)
+{
+	unsigned int child;
+
+	while((child = 2 * idx + 1) < edf->num) {
+		if(child + 1 < edf->num &&
+				edf_before(edf->heap[child + 1], edf->heap[child]))
+			child++;
+
+		if(!edf_before(edf->heap[child], tp))
+			break;
+
+		edf_heap_set(edf, idx, edf->heap[child]);
+		idx = child;
+	}
+
+	edf_heap_set(edf, idx, tp);
+}
+
+/**
+ * @brief Insert a thread into the EDF heap.
+ * @param edf EDF run queue.
+ * @param tp Thread to insert.
+ * @note This function runs in O(log n) time.
+ */
+static void raw_edf_heap_insert(struct edf_rq *edf, struct thread *tp)
+{
+	if(unlikely(edf->num >= CONFIG_EDF_RQ_SIZE))
+		panic("EDF run queue overflow!");
+
+	edf->num++;
+	edf_heap_up(edf, edf->num - 1, tp);
+}
+
+/**
+ * @brief Remove a thread from the EDF heap.
+ * @param edf EDF run queue.
+ * @param tp Thread to remove.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p tp was not on \p edf.
+ * @note This function runs in O(log n) time.
+ */
+static int raw_edf_heap_remove(struct edf_rq *edf, struct thread *tp)
+{
+	struct thread *last;
+	unsigned int idx;
+
+	idx = tp->se.heap_idx;
+	if(idx >= edf->num || edf->heap[idx] != tp)
+		return -EINVAL;
+
+	edf->num--;
+	last = edf->heap[edf->num];
+	edf->heap[edf->num] = NULL;
+
+	if(last != tp) {
+		if(idx && edf_before(last, edf->heap[(idx - 1) / 2]))
+			edf_heap_up(edf, idx, last);
+		else
+			edf_heap_down(edf, idx, last);
+	}
+
+	return -EOK;
+}
+
 #ifdef CONFIG_THREAD_QUEUE
 /**
  * @brief Add a new thread to a queue.
@@ -256,11 +449,12 @@ static void edf_thread_queue_remove(struct thread_queue *qp, struct thread *tp)
  */
 static void edf_add_thread(struct rq *rq, struct thread *tp)
 {
-	struct rr_rq *rr;
-
-	rr = &rq->rr_rq;
-	if(raw_edf_insert(&rr->run_queue, tp) == -EOK)
-		rq->num++;
+#ifdef CONFIG_EVENT_MUTEX
+	tp->ec = 0;
+#endif
+	edf_update_deadline(tp);
+	raw_edf_heap_insert(&rq->edf_rq, tp);
+	rq->num++;
 }
 
 /**
@@ -274,7 +468,7 @@ static int edf_rm_thread(struct rq *rq, struct thread *tp)
 {
 	int rc;
 
-	if((rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp)) == -EOK)
+	if((rc = raw_edf_heap_remove(&rq->edf_rq, tp)) == -EOK)
 		rq->num--;
 
 	return rc;
@@ -285,22 +479,67 @@ static int edf_rm_thread(struct rq *rq, struct thread *tp)
  * @param rq RQ to get the next runnable thread from.
  * @return The next runnable thread.
  * @retval NULL if no runnable thread was found.
+ *
+ * Threads on the run queue normally have the THREAD_RUNNING_FLAG set, so
+ * the root of the heap is returned in constant time.
  */
 static struct thread *edf_next_runnable(struct rq *rq)
 {
-	struct thread *runnable;
+	struct edf_rq *edf;
+	struct thread *runnable, *tp;
+	unsigned int idx;
+
+	edf = &rq->edf_rq;
+	if(!edf->num)
+		return NULL;
+
+	runnable = edf->heap[0];
+	if(likely(test_bit(THREAD_RUNNING_FLAG, &runnable->flags)))
+		return runnable;
 
-	for(runnable = rq->rr_rq.run_queue; runnable;
-			runnable = runnable->se.next) {
-		if(!test_bit(THREAD_RUNNING_FLAG, &runnable->flags))
+	runnable = NULL;
+	for(idx = 1; idx < edf->num; idx++) {
+		tp = edf->heap[idx];
+		if(!test_bit(THREAD_RUNNING_FLAG, &tp->flags))
 			continue;
-		else
-			break;
+
+		if(!runnable || edf_before(tp, runnable))
+			runnable = tp;
 	}
 
 	return runnable;
 }
 
+/**
+ * @brief Move a periodic thread to its next period.
+ * @param tp Thread to move.
+ *
+ * Changing the deadline of a queued thread breaks the heap order, so
+ * \p tp is taken off the heap while its period is advanced and put back
+ * afterwards.
+ */
+static void edf_next_period(struct thread *tp)
+{
+	struct rq *rq;
+	unsigned long flags;
+	bool queued = false;
+
+	rq = tp->rq;
+	if(rq) {
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		queued = raw_edf_heap_remove(&rq->edf_rq, tp) == -EOK;
+	}
+
+	edf_release(&tp->se, tp->se.release + tp->se.period);
+
+	if(rq) {
+		if(queued)
+			raw_edf_heap_insert(&rq->edf_rq, tp);
+
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	}
+}
+
 #ifdef CONFIG_PREEMPT
 /**
  * @brief Check if the current thread should be preempted.
@@ -335,7 +574,140 @@ static bool edf_preempt_check(struct rq *rq,
 	else
 		return prio(nxt) < prio(cur);
 }
+
+#ifdef CONFIG_SYS_EDF
+/**
+ * @brief Charge execution time to the EDF budget of a thread.
+ * @param tp Running thread.
+ * @param ms Execution time in miliseconds.
+ * @return True if \p tp should be preempted.
+ * @note Called from the system tick interrupt.
+ *
+ * When a periodic thread exhausts its budget, the rest of its work is
+ * postponed to the next period. This keeps an overrunning thread from
+ * pushing other threads past their deadlines.
+ */
+bool edf_charge_budget(struct thread *tp, int ms)
+{
+	struct rr_entity *se;
+
+	se = &tp->se;
+	if(!se->wcet)
+		return false;
+
+	if(se->budget > (unsigned long)ms) {
+		se->budget -= ms;
+		return false;
+	}
+
+	edf_next_period(tp);
+	return true;
+}
 #endif
+#endif
+
+/**
+ * @brief Set the EDF parameters of a thread.
+ * @param tp Thread to set the parameters for.
+ * @param period Period in miliseconds, 0 to make \p tp aperiodic.
+ * @param deadline Deadline relative to the start of each period in
+ *                 miliseconds. A deadline of 0 equals \p period.
+ * @param wcet Execution budget per period in miliseconds, 0 to disable
+ *             budget enforcement.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p deadline exceeds \p period or \p wcet exceeds
+ *                 \p deadline.
+ *
+ * The first period of \p tp starts when the parameters are applied, or
+ * when \p tp is first added to a run queue. Aperiodic threads keep the
+ * virtual deadline derived from their priority. The priority of a periodic
+ * thread is only used to break ties between equal deadlines.
+ */
+int edf_set_params(struct thread *tp, unsigned long period,
+		unsigned long deadline, unsigned long wcet)
+{
+	struct rr_entity *se;
+	struct rq *rq;
+	unsigned long flags = 0UL;
+	bool queued = false;
+
+	if(!deadline)
+		deadline = period;
+
+	if(deadline > period || wcet > deadline)
+		return -EINVAL;
+
+	rq = tp->rq;
+	if(rq) {
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		queued = raw_edf_heap_remove(&rq->edf_rq, tp) == -EOK;
+	}
+
+	se = &tp->se;
+	se->period = period;
+	se->rel_deadline = deadline;
+	se->wcet = wcet;
+	se->budget = wcet;
+	se->deadline = 0;
+
+	if(rq) {
+		edf_update_deadline(tp);
+		if(queued)
+			raw_edf_heap_insert(&rq->edf_rq, tp);
+
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Wait for the next period of the current thread.
+ *
+ * Should be called by a periodic thread when the work of its current period
+ * is done. A deadline miss is counted if the work was finished after the
+ * deadline. The thread sleeps until the start of its next period, or returns
+ * right away if that period has already started. Aperiodic threads return
+ * immediately.
+ */
+void edf_wait_period(void)
+{
+	struct thread *tp;
+	struct rr_entity *se;
+	unsigned long flags;
+	time_t now, delay;
+
+	tp = current_thread();
+	se = &tp->se;
+
+	if(!se->period)
+		return;
+
+	irq_save_and_disable(&flags);
+	now = edf_now();
+	if(now > se->deadline)
+		se->misses++;
+
+	edf_next_period(tp);
+	delay = se->release - now;
+	irq_restore(&flags);
+
+	if(delay > 0)
+		sleep((unsigned)delay);
+	else
+		yield();
+}
+
+/**
+ * @brief Get the number of missed deadlines of a thread.
+ * @param tp Thread to get the number of deadline misses for.
+ * @return The number of periods in which \p tp missed its deadline.
+ */
+unsigned long edf_deadline_misses(struct thread *tp)
+{
+	return tp->se.misses;
+}
 
 #ifdef CONFIG_EVENT_MUTEX
 /**
@@ -361,20 +733,20 @@ static struct thread *edf_thread_after(struct thread *tp)
  */
 static void edf_print_rq(struct rq *rq)
 {
-	struct rr_rq *rr;
+	struct edf_rq *edf;
 	struct thread *tp;
+	unsigned int idx;
 
-	rr = &rq->rr_rq;
-	tp = rr->run_queue;
+	edf = &rq->edf_rq;
 
-	while(tp) {
+	for(idx = 0; idx < edf->num; idx++) {
+		tp = edf->heap[idx];
 #ifdef CONFIG_PREEMPT
 		printf("Name: %s - Preempt count: %i - Flags: %lu\n",
 				tp->name, tp->preempt_cnt, tp->flags);
 #else
 		printf("Name: %s - Flags: %lu\n", tp->name, tp->flags);
 #endif
-		tp = tp->se.next;
 	}
 }
 #endif
@@ -167,7 +167,6 @@ int raw_event_wait(struct thread_queue *qp, unsigned ms)
 {
 	struct thread *tp;
 	unsigned long flags;
-	struct clocksource *cs;
 
 	preempt_disable();
 	raw_spin_lock_irq(&qp->lock, &flags);
@@ -181,11 +180,10 @@ int raw_event_wait(struct thread_queue *qp, unsigned ms)
 	}
 
 	tp = current_thread();
-	cs = tp->rq->source;
 
 	if(ms)
-		tp->timer = timer_create(cs, ms, &event_tmo, (void*)qp,
-				               TIMER_ONESHOT_MASK);
+		tp->timer = sched_arm_thread_timer(tp, ms, &event_tmo,
+				(void*)qp);
 	else
 		tp->timer = NULL;
 
@@ -212,10 +210,12 @@ void event_notify_irq(struct thread_queue *qp)
 	struct thread *tp;
 
 	tp = qp->qhead;
-	if(!tp)
+	if(!tp) {
 		qp->qhead = SIGNALED;
-	else if(tp != SIGNALED)
+	} else if(tp != SIGNALED) {
 		tp->ec++;
+		raw_sched_kick_idle(sched_get_cpu_rq());
+	}
 }
 
 int raw_event_notify_broadcast(struct thread_queue *qp)
@@ -108,7 +108,12 @@ static void fifo_thread_queue_remove(struct thread_queue *qp, struct thread *tp)
 static void fifo_add_thread(struct rq *rq, struct thread *tp)
 {
 	rq->num++;
+#ifdef CONFIG_RR_PRIO_BITMAP
+	/* Priorities are not taken into account, use a single level */
+	rr_prio_rq_insert(&rq->rr_rq, tp, 0);
+#else
 	fifo_queue_insert(&rq->rr_rq.run_queue, tp);
+#endif
 }
 
 /**
@@ -122,7 +127,12 @@ static int fifo_rm_thread(struct rq *rq, struct thread *tp)
 {
 	int rc;
 
-	if((rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp)) == 0)
+#ifdef CONFIG_RR_PRIO_BITMAP
+	rc = rr_prio_rq_remove(&rq->rr_rq, tp);
+#else
+	rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp);
+#endif
+	if(rc == 0)
 		rq->num--;
 	return rc;
 }
@@ -135,6 +145,9 @@ static int fifo_rm_thread(struct rq *rq, struct thread *tp)
  */
 static struct thread *fifo_next_runnable(struct rq *rq)
 {
+#ifdef CONFIG_RR_PRIO_BITMAP
+	return rr_prio_rq_next_runnable(&rq->rr_rq);
+#else
 	struct thread *runnable;
 
 	for(runnable = rq->rr_rq.run_queue; runnable; 
@@ -146,6 +159,7 @@ static struct thread *fifo_next_runnable(struct rq *rq)
 	}
 	
 	return runnable;
+#endif
 }
 
 #ifdef CONFIG_EVENT_MUTEX
@@ -29,14 +29,6 @@
 #include <etaos/mem.h>
 #include <etaos/event.h>
 
-static inline bool ipm_queue_is_full(struct ipm_queue *iq)
-{
-	if(iq->wr_idx >= iq->num)
-		return true;
-	else
-		return false;
-}
-
 /**
  * @brief Initialise a new IPM queue.
  * @param iq Queue to initialise.
@@ -46,17 +38,13 @@ void ipm_queue_init(struct ipm_queue *iq, size_t len)
 {
 	void *ptr;
 
-	thread_queue_init(&iq->qp);
-	spinlock_init(&iq->lock);
-	iq->qp.qhead = NULL;
+	msg_ring_init(&iq->ring, 0);
 	ptr = kzalloc(sizeof(*iq->msgs) * len);
 	if(!ptr)
 		return;
 
 	iq->msgs = ptr;
-	iq->num = len;
-	iq->wr_idx = 0;
-	iq->rd_idx = 0;
+	iq->ring.num = len;
 }
 
 /**
@@ -65,61 +53,125 @@ void ipm_queue_init(struct ipm_queue *iq, size_t len)
  * @param buff Message to send.
  * @param len Length of \p buff.
  * @return An error code.
+ * @retval -EAGAIN if the queue is full.
+ * @note This function is safe to call from an ISR.
  */
 int ipm_post_msg(struct ipm_queue *iq, const void *buff, size_t len)
 {
+	struct msg_ring *ring = &iq->ring;
 	unsigned long flags;
 	struct ipm *msg;
+	bool room;
 
-	if(ipm_queue_is_full(iq))
-		return -EINVAL;
-
-	spin_lock_irqsave(&iq->lock, flags);
-	msg = &iq->msgs[iq->wr_idx];
-	iq->wr_idx += 1;
-	spin_unlock_irqrestore(&iq->lock, flags);
+	spin_lock_irqsave(&ring->lock, flags);
+	if(msg_ring_full(ring)) {
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -EAGAIN;
+	}
 
+	msg = &iq->msgs[raw_msg_ring_push(ring)];
 	msg->data = buff;
 	msg->len = len;
+	room = !msg_ring_full(ring);
+	spin_unlock_irqrestore(&ring->lock, flags);
 
-	event_notify(&iq->qp);
+	msg_ring_notify_post(ring, room);
 	return -EOK;
 }
 
 /**
- * @brief Get a message from a queue.
- * @param iq Queue to get the message from.
- * @param msg Memory to store the message into.
+ * @brief Send a message to a queue, wait for a free slot if it is full.
+ * @param iq Queue to post the message to.
+ * @param buff Message to send.
+ * @param len Length of \p buff.
+ * @param ms Maximum time to wait for a free slot in miliseconds.
  * @return An error code.
+ * @retval -EAGAIN if no slot became available within \p ms miliseconds.
+ * @note Set \p ms to EVM_WAIT_INFINITE to wait infinitly.
+ * @warning NEVER call this from an ISR, use ipm_post_msg instead.
  */
-int ipm_get_msg(struct ipm_queue *iq, struct ipm *msg)
+int ipm_post_msg_wait(struct ipm_queue *iq, const void *buff, size_t len,
+		unsigned ms)
 {
-	unsigned long flags;
+	int rv;
 
-	/* check if there are messages available */
-	spin_lock_irqsave(&iq->lock, flags);
-	if(iq->rd_idx >= iq->wr_idx) {
-		spin_unlock_irqrestore(&iq->lock, flags);
-		raw_event_wait(&iq->qp, EVM_WAIT_INFINITE);
-
-		spin_lock_irqsave(&iq->lock, flags);
-		if(iq->wr_idx == iq->rd_idx) {
-			spin_unlock_irqrestore(&iq->lock, flags);
-			return -EINVAL;
-		}
+	if(!iq->ring.num)
+		return -EINVAL;
+
+	while((rv = ipm_post_msg(iq, buff, len)) == -EAGAIN) {
+		if(msg_ring_wait_slot(&iq->ring, ms))
+			return -EAGAIN;
 	}
 
-	*msg = iq->msgs[iq->rd_idx];
-	iq->rd_idx += 1;
+	return rv;
+}
 
-	if(iq->rd_idx != iq->wr_idx) {
-		spin_unlock_irqrestore(&iq->lock, flags);
-		event_notify(&iq->qp);
-		return -EOK;
-	}
+/**
+ * @brief Get a batch of messages from a queue.
+ * @param iq Queue to get the messages from.
+ * @param msgs Array to store the messages into.
+ * @param num Length of \p msgs.
+ * @param ms Maximum time to wait for a message in miliseconds.
+ * @return The number of messages stored in \p msgs or an error code.
+ * @retval -EAGAIN if no message arrived within \p ms miliseconds.
+ * @note Set \p ms to EVM_WAIT_INFINITE to wait infinitly.
+ *
+ * Waits until at least one message is available and then removes all
+ * pending messages, up to \p num, from the queue under a single lock.
+ */
+int ipm_get_msgs(struct ipm_queue *iq, struct ipm *msgs, size_t num,
+		unsigned ms)
+{
+	struct msg_ring *ring = &iq->ring;
+	unsigned long flags;
+	bool was_full, more;
+	size_t idx;
 
-	spin_unlock_irqrestore(&iq->lock, flags);
-	return -EOK;
+	if(!num)
+		return -EINVAL;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if(msg_ring_wait_msg(ring, &flags, ms))
+		return -EAGAIN;
+
+	was_full = msg_ring_full(ring);
+	for(idx = 0; idx < num && ring->count; idx++)
+		msgs[idx] = iq->msgs[raw_msg_ring_pop(ring)];
+	more = ring->count != 0;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	msg_ring_notify_get(ring, was_full, more);
+	return (int)idx;
+}
+
+/**
+ * @brief Get a message from a queue.
+ * @param iq Queue to get the message from.
+ * @param msg Memory to store the message into.
+ * @param ms Maximum time to wait in miliseconds.
+ * @return An error code.
+ * @retval -EAGAIN if no message arrived within \p ms miliseconds.
+ * @note Set \p ms to EVM_WAIT_INFINITE to wait infinitly.
+ */
+int ipm_get_msg_tmo(struct ipm_queue *iq, struct ipm *msg, unsigned ms)
+{
+	int rv;
+
+	rv = ipm_get_msgs(iq, msg, 1, ms);
+	return rv < 0 ? rv : -EOK;
+}
+
+/**
+ * @brief Get a message from a queue.
+ * @param iq Queue to get the message from.
+ * @param msg Memory to store the message into.
+ * @return An error code.
+ *
+ * Waits until a message is available.
+ */
+int ipm_get_msg(struct ipm_queue *iq, struct ipm *msg)
+{
+	return ipm_get_msg_tmo(iq, msg, EVM_WAIT_INFINITE);
 }
 
 /**
@@ -131,19 +183,6 @@ int ipm_get_msg(struct ipm_queue *iq, struct ipm *msg)
  */
 bool ipm_reset_queue(struct ipm_queue *iq)
 {
-	unsigned long flags;
-
-	spin_lock_irqsave(&iq->lock, flags);
-	if(iq->qp.qhead != SIGNALED && iq->qp.qhead != NULL) {
-		spin_unlock_irqrestore(&iq->lock, flags);
-		return false;
-	}
-
-	iq->qp.qhead = NULL;
-	iq->wr_idx = 0;
-	iq->rd_idx = 0;
-	spin_unlock_irqrestore(&iq->lock, flags);
-
-	return true;
+	return msg_ring_reset(&iq->ring);
 }
 /* @} */
@@ -23,102 +23,221 @@
 
 #include <etaos/kernel.h>
 #include <etaos/stdlib.h>
-#include <etaos/math.h>
 #include <etaos/types.h>
 #include <etaos/error.h>
 #include <etaos/sched.h>
 #include <etaos/thread.h>
-#include <etaos/mem.h>
-#include <etaos/list.h>
+#include <etaos/irq.h>
+#include <etaos/panic.h>
+#include <etaos/spinlock.h>
+#include <etaos/clocksource.h>
 
-#include "rr_shared.h"
+#define LOTTERY_MAX_TICKETS 0xFFFF //!< Maximum number of tickets per thread.
 
-static struct lottery_ticket *lottery_take_ticket(void);
+/**
+ * @brief Largest power of two that fits in the Fenwick tree.
+ */
+#define LOTTERY_TREE_TOP \
+	(CONFIG_LOTTERY_RQ_SIZE >= 128 ? 128 : \
+	 CONFIG_LOTTERY_RQ_SIZE >= 64 ? 64 : \
+	 CONFIG_LOTTERY_RQ_SIZE >= 32 ? 32 : \
+	 CONFIG_LOTTERY_RQ_SIZE >= 16 ? 16 : \
+	 CONFIG_LOTTERY_RQ_SIZE >= 8 ? 8 : \
+	 CONFIG_LOTTERY_RQ_SIZE >= 4 ? 4 : 2)
 
-struct lottery_pool_head {
-	struct list_head tickets;
-	unsigned long num;
-};
+/**
+ * @brief Convert a priority into a number of lottery tickets.
+ * @param prio Priority to convert.
+ * @return The number of tickets for \p prio.
+ *
+ * The number of tickets is \f$10 - p/25\f$, rounded to the nearest
+ * integer, where \f$p\f$ is the priority. Each thread receives at least a
+ * single ticket.
+ */
+static inline unsigned short lottery_prio_tickets(unsigned char prio)
+{
+	if(prio >= 238)
+		return 1;
+
+	return 10 - (prio + 12) / 25;
+}
 
 /**
- * @brief Add a new thread to a lottery run queue.
- * @param rq Run queue to add \p tp to.
- * @param tp Thread which has to be added to the given run queue.
+ * @brief Get the base number of tickets of a thread.
+ * @param tp Thread to get the tickets for.
+ * @return The number of tickets assigned to \p tp, excluding compensation.
  */
-static void lottery_add_thread(struct rq *rq, struct thread *tp)
+static inline unsigned short lottery_base_tickets(struct thread *tp)
 {
-	struct lottery_ticket *ticket;
-	double tickets;
-	unsigned int idx, _tickets;
-
-	/* check if the thread has tickets assigned yet */
-	if(list_empty(&tp->se.tickets)) {
-		if(tp->prio < 250) {
-			tickets = -0.04;
-			tickets *= tp->prio;
-			tickets += 10;
-		} else {
-			tickets = 1;
-		}
+	if(tp->se.tickets)
+		return tp->se.tickets;
+
+	return lottery_prio_tickets(prio(tp));
+}
+
+/**
+ * @brief Get the number of tickets a thread competes with.
+ * @param tp Thread to get the tickets for.
+ * @return The base and compensation tickets of \p tp.
+ */
+static inline unsigned short lottery_tickets(struct thread *tp)
+{
+	return lottery_base_tickets(tp) + tp->se.comp;
+}
+
+/**
+ * @brief Add a value to a slot in the Fenwick tree.
+ * @param lrq Lottery run queue.
+ * @param slot Slot to update.
+ * @param delta Value to add to \p slot.
+ * @note This function runs in O(log n) time.
+ */
+static void raw_lottery_tree_add(struct lottery_rq *lrq, unsigned int slot,
+		long delta)
+{
+	unsigned int idx;
+
+	for(idx = slot + 1; idx <= CONFIG_LOTTERY_RQ_SIZE; idx += idx & -idx)
+		lrq->tree[idx] += delta;
+}
+
+/**
+ * @brief Find the slot that holds a ticket.
+ * @param lrq Lottery run queue.
+ * @param ticket Ticket to look up.
+ * @return The slot which tickets contain \p ticket.
+ * @note This function runs in O(log n) time.
+ */
+static unsigned int raw_lottery_tree_find(struct lottery_rq *lrq,
+		unsigned long ticket)
+{
+	unsigned int pos, step;
 
-		_tickets = (unsigned int)round(tickets);
+	pos = 0;
+	for(step = LOTTERY_TREE_TOP; step; step >>= 1) {
+		if(pos + step > CONFIG_LOTTERY_RQ_SIZE)
+			continue;
 
-		for(idx = 0; idx < _tickets; idx++) {
-			ticket = lottery_take_ticket();
-			list_add(&ticket->list, &tp->se.tickets);
+		if(lrq->tree[pos + step] <= ticket) {
+			pos += step;
+			ticket -= lrq->tree[pos];
 		}
 	}
 
-	rq->num++;
-	rr_shared_queue_insert(&rq->rr_rq.run_queue, tp);
+	return pos;
 }
 
 /**
- * @brief Remove a thread from the lottery run queue.
- * @param rq Run queue to remove from.
- * @param tp Thread which is to be removed.
- * @return An error code.
+ * @brief Check if a thread is on a lottery run queue.
+ * @param lrq Lottery run queue.
+ * @param tp Thread to check.
+ * @return True if \p tp is on \p lrq.
  */
-static int lottery_remove_thread(struct rq *rq, struct thread *tp)
+static inline bool lottery_on_rq(struct lottery_rq *lrq, struct thread *tp)
 {
-	int rc;
-
-	if((rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp)) == 0)
-		rq->num--;
-	
-	return rc;
+	return tp->se.slot < lrq->num && lrq->slots[tp->se.slot] == tp;
 }
 
-static struct lottery_pool_head lottery_tickets = {
-	.tickets = STATIC_INIT_LIST_HEAD(lottery_tickets.tickets),
-	.num = 0,
-};
+/**
+ * @brief Update the tickets of a thread on a lottery run queue.
+ * @param lrq Lottery run queue.
+ * @param tp Thread to update.
+ */
+static void raw_lottery_update(struct lottery_rq *lrq, struct thread *tp)
+{
+	unsigned short weight;
+	long delta;
+
+	if(!lottery_on_rq(lrq, tp))
+		return;
+
+	weight = lottery_tickets(tp);
+	delta = (long)weight - tp->se.weight;
+	raw_lottery_tree_add(lrq, tp->se.slot, delta);
+	lrq->total += delta;
+	tp->se.weight = weight;
+}
 
 /**
- * @brief Return a lottery ticket to the allocator.
- * @param ticket Ticket to return.
+ * @brief Update the tickets of a thread.
+ * @param tp Thread which tickets have changed.
  */
-static void lottery_return_ticket(struct lottery_ticket *ticket)
+static void lottery_update(struct thread *tp)
 {
-	list_del(&ticket->list);
-	list_add(&ticket->list, &lottery_tickets.tickets);
+	unsigned long flags;
+	struct rq *rq;
+
+	rq = tp->rq;
+	if(!rq)
+		return;
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	raw_lottery_update(&rq->lottery_rq, tp);
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
 /**
- * @brief Free all memory allocated by the lottery scheduler.
- * @param tp Thread which is about to be killed.
- * @note This function does not free the actual thread. It merely free's up
- *       allocated lottery tickets (they're returned to the ticket allocator).
+ * @brief Add a new thread to a lottery run queue.
+ * @param rq Run queue to add \p tp to.
+ * @param tp Thread which has to be added to the given run queue.
+ * @note This function runs in O(log n) time.
  */
-static void lottery_kill_thread(struct thread *tp)
+static void lottery_add_thread(struct rq *rq, struct thread *tp)
 {
-	struct list_head *carriage, *tmp;
-	struct lottery_ticket *ticket;
+	struct lottery_rq *lrq;
+	unsigned int slot;
+
+	lrq = &rq->lottery_rq;
+	if(unlikely(lrq->num >= CONFIG_LOTTERY_RQ_SIZE))
+		panic("Lottery run queue overflow!");
+
+	slot = lrq->num++;
+	lrq->slots[slot] = tp;
+	tp->se.slot = slot;
+	tp->se.weight = lottery_tickets(tp);
+
+	raw_lottery_tree_add(lrq, slot, tp->se.weight);
+	lrq->total += tp->se.weight;
+	rq->num++;
+}
 
-	list_for_each_safe(carriage, tmp, &tp->se.tickets) {
-		ticket = list_entry(carriage, struct lottery_ticket, list);
-		lottery_return_ticket(ticket);
+/**
+ * @brief Remove a thread from the lottery run queue.
+ * @param rq Run queue to remove from.
+ * @param tp Thread which is to be removed.
+ * @return An error code.
+ * @note This function runs in O(log n) time.
+ *
+ * The thread in the last slot is moved into the slot of \p tp, which keeps
+ * the occupied slots consecutive.
+ */
+static int lottery_remove_thread(struct rq *rq, struct thread *tp)
+{
+	struct lottery_rq *lrq;
+	struct thread *last;
+	unsigned int slot;
+
+	lrq = &rq->lottery_rq;
+	if(!lottery_on_rq(lrq, tp))
+		return -EINVAL;
+
+	slot = tp->se.slot;
+	lrq->num--;
+	last = lrq->slots[lrq->num];
+	lrq->slots[lrq->num] = NULL;
+
+	raw_lottery_tree_add(lrq, slot, -(long)tp->se.weight);
+	lrq->total -= tp->se.weight;
+
+	if(last != tp) {
+		raw_lottery_tree_add(lrq, lrq->num, -(long)last->se.weight);
+		raw_lottery_tree_add(lrq, slot, last->se.weight);
+		lrq->slots[slot] = last;
+		last->se.slot = slot;
 	}
+
+	rq->num--;
+	return -EOK;
 }
 
 #ifdef CONFIG_EVENT_MUTEX
@@ -131,159 +250,163 @@ static struct thread *lottery_thread_after(struct thread *tp)
 }
 #endif
 
-static inline bool lottery_single_thread_available(struct rq *rq)
-{
-	struct thread *tp;
-
-	tp = rq->rr_rq.run_queue;
-	if(tp) {
-		if(tp->se.next)
-			return false;
-	}
-
-	return true;
-}
-
 #ifdef CONFIG_PREEMPT
 static bool lottery_preempt_chk(struct rq *rq, struct thread *cur,
 		struct thread *next)
 {
-	double tickets_cur, tickets_next;
+	return lottery_tickets(cur) >= lottery_tickets(next);
+}
+#endif
+
+/**
+ * @brief Hand out compensation tickets.
+ * @param rq Run queue \p tp is on.
+ * @param tp Thread that is about to lose the CPU.
+ *
+ * A thread that gives up the CPU after running for a fraction \f$f\f$ of
+ * the lottery quantum has its tickets inflated by \f$1/f\f$ until it loses
+ * the CPU again. The run time is measured using the scheduling clock, so the
+ * granularity of \f$f\f$ is a single tick.
+ */
+static void lottery_put_prev(struct rq *rq, struct thread *tp)
+{
+	struct lottery_rq *lrq;
+	unsigned long now, used, tickets, comp;
 
-	tickets_cur = tickets_next = -0.04;
+	lrq = &rq->lottery_rq;
+	now = (unsigned long)clocksource_get_tick(rq->source);
+	used = now - lrq->stamp;
+	lrq->stamp = now;
 
-	if(cur->prio < 250) {
-		tickets_cur *= cur->prio;
-		tickets_cur += 10;
-	} else {
-		tickets_cur = 1;
-	}
+	comp = 0;
+	if(tp->se.comp_enable && used < CONFIG_LOTTERY_QUANTUM) {
+		if(!used)
+			used = 1;
 
-	if(next->prio < 250) {
-		tickets_next *= next->prio;
-		tickets_next += 10;
-	} else {
-		tickets_next = 1;
-	}
+		tickets = lottery_base_tickets(tp);
+		comp = tickets * CONFIG_LOTTERY_QUANTUM / used - tickets;
 
-	if(round(tickets_cur) >= round(tickets_next))
-		return true;
+		if(comp > LOTTERY_MAX_TICKETS - tickets)
+			comp = LOTTERY_MAX_TICKETS - tickets;
+	}
 
-	return false;
+	tp->se.comp = comp;
+	raw_lottery_update(lrq, tp);
 }
-#endif
 
 /**
  * @brief Get the next runnable thread from the lottery scheduler.
  * @param rq Run queue to pick a thread from.
  * @return The next runnable thread.
+ * @note This function runs in O(log n) time.
  *
- * A new thread is selected for execution using a pseudo random number
- * generator.
+ * A random ticket is drawn from all tickets on the run queue. The winning
+ * thread is looked up in the Fenwick tree.
  */
 static struct thread *lottery_next_runnable(struct rq *rq)
 {
-	unsigned long num;
-	struct thread *runnable;
-	struct list_head *carriage;
-	struct lottery_ticket *_ticket;
-
-	if(lottery_single_thread_available(rq))
-		return rq->rr_rq.run_queue;
-
-try_again:
-	num = random_m(lottery_tickets.num);
-
-	for(runnable = rq->rr_rq.run_queue; runnable; 
-			runnable = runnable->se.next) {
-		list_for_each(carriage, &runnable->se.tickets) {
-			_ticket = list_entry(carriage, struct lottery_ticket,
-					list);
-			if(_ticket->ticket == num) {
-				return runnable;
-			}
-		}
-	}
+	struct lottery_rq *lrq;
+	unsigned long ticket;
+
+	lrq = &rq->lottery_rq;
+	if(!lrq->num)
+		return NULL;
 
-	if(rq->num > 0)
-		goto try_again;
+	if(lrq->num == 1)
+		return lrq->slots[0];
 
-	return NULL;
+	ticket = random_m(lrq->total - 1);
+	return lrq->slots[raw_lottery_tree_find(lrq, ticket)];
 }
 
-#define LOTTERY_POOL_SIZE 20
-#define LOTTERY_RESIZE_SIZE 5
-
 /**
- * @brief Generate new lottery tickets.
- * @param num Amount of tickets to generate.
+ * @brief Set the number of lottery tickets of a thread.
+ * @param tp Thread to set the tickets for.
+ * @param tickets Number of tickets, 0 to derive them from the priority.
  * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p tp is \p NULL.
  */
-static int lottery_generate_tickets(int num)
+int lottery_set_tickets(struct thread *tp, unsigned short tickets)
 {
-	struct lottery_ticket *ticket;
-	int idx = 0;
+	unsigned long flags;
 
-	for(; idx < num; idx++) {
-		ticket = kzalloc(sizeof(*ticket));
-		if(!ticket)
-			return -ENOMEM;
+	if(!tp)
+		return -EINVAL;
 
-		ticket->ticket = lottery_tickets.num;
-		lottery_tickets.num++;
-		list_add(&ticket->list, &lottery_tickets.tickets);
-	}
+	irq_save_and_disable(&flags);
+	tp->se.tickets = tickets;
+	irq_restore(&flags);
 
+	lottery_update(tp);
 	return -EOK;
 }
 
 /**
- * @brief Allocate a lottery ticket.
- * @return The allocated lottery ticket.
+ * @brief Enable or disable compensation tickets for a thread.
+ * @param tp Thread to configure.
+ * @param enable True to enable compensation tickets.
+ *
+ * Threads with compensation tickets enabled receive extra tickets when
+ * they do not use their full quantum, which gives I/O bound threads
+ * their fair share of the CPU.
  */
-static struct lottery_ticket *lottery_take_ticket(void)
+void lottery_set_compensation(struct thread *tp, bool enable)
 {
-	struct list_head *ticket_entry;
+	unsigned long flags;
 
-	if(list_empty(&lottery_tickets.tickets)) {
-		lottery_generate_tickets(LOTTERY_RESIZE_SIZE);
-	}
+	irq_save_and_disable(&flags);
+	tp->se.comp_enable = enable;
+	if(!enable)
+		tp->se.comp = 0;
+	irq_restore(&flags);
 
-	ticket_entry = lottery_tickets.tickets.next;
-	list_del(ticket_entry);
-	return list_entry(ticket_entry, struct lottery_ticket, list);
+	lottery_update(tp);
 }
 
 /**
- * @brief Initialise the lottery scheduler
+ * @brief Transfer lottery tickets from one thread to another.
+ * @param from Thread to take the tickets from.
+ * @param to Thread to give the tickets to.
+ * @param num Number of tickets to transfer.
+ * @return The number of tickets transferred.
+ *
+ * A thread that blocks on another thread can transfer its tickets to speed
+ * up that thread. \p from always keeps at least one ticket. The tickets
+ * can be returned by transferring them back.
  */
-static void lottery_init(void)
+unsigned short lottery_transfer_tickets(struct thread *from,
+		struct thread *to, unsigned short num)
 {
-	struct lottery_ticket *ticket;
-	int idx = 0;
+	unsigned short from_tickets, to_tickets;
+	unsigned long flags;
 
-	for(; idx < LOTTERY_POOL_SIZE; idx++) {
-		ticket = kzalloc(sizeof(*ticket));
-		if(!ticket)
-			return;
+	irq_save_and_disable(&flags);
+	from_tickets = lottery_base_tickets(from);
+	to_tickets = lottery_base_tickets(to);
 
-		ticket->ticket = idx;
-		list_add(&ticket->list, &lottery_tickets.tickets);
-	}
+	if(num >= from_tickets)
+		num = from_tickets - 1;
+	if(num > LOTTERY_MAX_TICKETS - to_tickets)
+		num = LOTTERY_MAX_TICKETS - to_tickets;
+
+	from->se.tickets = from_tickets - num;
+	to->se.tickets = to_tickets + num;
+	irq_restore(&flags);
 
-	lottery_tickets.num = LOTTERY_POOL_SIZE;
-	return;
+	lottery_update(from);
+	lottery_update(to);
+	return num;
 }
 
 /**
  * @brief Lottery scheduling class.
  */
 struct sched_class lottery_class = {
-	.init = &lottery_init,
-	.kill = &lottery_kill_thread,
 	.rm_thread = &lottery_remove_thread,
 	.add_thread = &lottery_add_thread,
 	.next_runnable = &lottery_next_runnable,
+	.put_prev = &lottery_put_prev,
 #ifdef CONFIG_PREEMPT
 	.preempt_chk = &lottery_preempt_chk,
 #endif
@@ -294,4 +417,3 @@ struct sched_class lottery_class = {
 };
 
 /** @} */
-
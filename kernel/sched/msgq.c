@@ -0,0 +1,188 @@
+/*
+ *  ETA/OS - Message queues
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup msgq
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/error.h>
+#include <etaos/thread.h>
+#include <etaos/types.h>
+#include <etaos/string.h>
+#include <etaos/msgq.h>
+#include <etaos/mem.h>
+#include <etaos/event.h>
+
+#define MSGQ_MAX 255
+
+static inline uint8_t *msgq_slot(struct msgq *mq, uint8_t idx)
+{
+	return mq->pool + (size_t)idx * MSGQ_SLOT_SIZE(mq->size);
+}
+
+/**
+ * @brief Initialise a message queue on top of a preallocated pool.
+ * @param mq Message queue to initialise.
+ * @param pool Memory for the message slots.
+ * @param size Maximum size of a single message.
+ * @param depth Maximum number of queued messages.
+ * @return An error code.
+ * @note \p pool should be at least MSGQ_POOL_SIZE(\p size, \p depth) bytes.
+ *
+ * Neither \p size nor \p depth can be larger than 255.
+ */
+int msgq_init_pool(struct msgq *mq, void *pool, size_t size, size_t depth)
+{
+	if(!pool || !size || !depth || size > MSGQ_MAX || depth > MSGQ_MAX)
+		return -EINVAL;
+
+	msg_ring_init(&mq->ring, depth);
+	mq->pool = pool;
+	mq->size = size;
+
+	return -EOK;
+}
+
+/**
+ * @brief Initialise a message queue.
+ * @param mq Message queue to initialise.
+ * @param size Maximum size of a single message.
+ * @param depth Maximum number of queued messages.
+ * @return An error code.
+ *
+ * The message slots are allocated once, sending and receiving messages
+ * does not touch the heap.
+ */
+int msgq_init(struct msgq *mq, size_t size, size_t depth)
+{
+	void *pool;
+	int rv;
+
+	if(!size || !depth || size > MSGQ_MAX || depth > MSGQ_MAX)
+		return -EINVAL;
+
+	pool = kzalloc(MSGQ_POOL_SIZE(size, depth));
+	if(!pool)
+		return -ENOMEM;
+
+	rv = msgq_init_pool(mq, pool, size, depth);
+	if(rv)
+		kfree(pool);
+
+	return rv;
+}
+
+/**
+ * @brief Copy a message into a message queue.
+ * @param mq Queue to send the message to.
+ * @param data Message to send.
+ * @param len Length of \p data.
+ * @return An error code.
+ * @retval -EINVAL if \p len is larger than the maximum message size.
+ * @retval -EAGAIN if the queue is full.
+ * @note This function is safe to call from an ISR.
+ */
+int msgq_send(struct msgq *mq, const void *data, size_t len)
+{
+	struct msg_ring *ring = &mq->ring;
+	unsigned long flags;
+	uint8_t *slot;
+	bool room;
+
+	if(len > mq->size)
+		return -EINVAL;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if(msg_ring_full(ring)) {
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -EAGAIN;
+	}
+
+	slot = msgq_slot(mq, raw_msg_ring_push(ring));
+	slot[0] = len;
+	memcpy(slot + 1, data, len);
+	room = !msg_ring_full(ring);
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	msg_ring_notify_post(ring, room);
+	return -EOK;
+}
+
+/**
+ * @brief Copy a message into a message queue, wait if it is full.
+ * @param mq Queue to send the message to.
+ * @param data Message to send.
+ * @param len Length of \p data.
+ * @param ms Maximum time to wait for a free slot in miliseconds.
+ * @return An error code.
+ * @retval -EAGAIN if no slot became available within \p ms miliseconds.
+ * @note Set \p ms to EVM_WAIT_INFINITE to wait infinitly.
+ * @warning NEVER call this from an ISR, use msgq_send instead.
+ */
+int msgq_send_wait(struct msgq *mq, const void *data, size_t len,
+		unsigned ms)
+{
+	int rv;
+
+	while((rv = msgq_send(mq, data, len)) == -EAGAIN) {
+		if(msg_ring_wait_slot(&mq->ring, ms))
+			return -EAGAIN;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Receive a message from a message queue.
+ * @param mq Queue to receive the message from.
+ * @param buff Buffer to copy the message into.
+ * @param len Length of \p buff.
+ * @param ms Maximum time to wait for a message in miliseconds.
+ * @return The length of the received message or an error code.
+ * @retval -EAGAIN if no message arrived within \p ms miliseconds.
+ * @note Set \p ms to EVM_WAIT_INFINITE to wait infinitly.
+ *
+ * If the message doesn't fit in \p buff, only the first \p len bytes are
+ * copied. The rest of the message is discarded.
+ */
+int msgq_recv(struct msgq *mq, void *buff, size_t len, unsigned ms)
+{
+	struct msg_ring *ring = &mq->ring;
+	unsigned long flags;
+	uint8_t *slot;
+	bool was_full, more;
+	int rv;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if(msg_ring_wait_msg(ring, &flags, ms))
+		return -EAGAIN;
+
+	was_full = msg_ring_full(ring);
+	slot = msgq_slot(mq, raw_msg_ring_pop(ring));
+	rv = slot[0];
+	memcpy(buff, slot + 1, (size_t)rv < len ? (size_t)rv : len);
+	more = ring->count != 0;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	msg_ring_notify_get(ring, was_full, more);
+	return rv;
+}
+
+/* @} */
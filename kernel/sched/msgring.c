@@ -0,0 +1,194 @@
+/*
+ *  ETA/OS - Message rings
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup ipm
+ */
+/* @{ */
+
+#include <etaos/kernel.h>
+#include <etaos/error.h>
+#include <etaos/thread.h>
+#include <etaos/types.h>
+#include <etaos/event.h>
+#include <etaos/msgring.h>
+
+static inline bool msg_ring_has_waiters(struct thread_queue *qp)
+{
+	return qp->qhead && qp->qhead != SIGNALED;
+}
+
+/**
+ * @brief Initialise a message ring.
+ * @param ring Ring to initialise.
+ * @param num Number of slots.
+ */
+void msg_ring_init(struct msg_ring *ring, uint8_t num)
+{
+	thread_queue_init(&ring->qp);
+	thread_queue_init(&ring->wq);
+	spinlock_init(&ring->lock);
+	ring->qp.qhead = NULL;
+	ring->wq.qhead = NULL;
+	ring->num = num;
+	ring->count = 0;
+	ring->wr_idx = 0;
+	ring->rd_idx = 0;
+}
+
+/**
+ * @brief Drop all queued messages.
+ * @param ring Ring to reset.
+ * @return True or false based on whether there are still threads waiting.
+ * @retval false if there are still threads waiting.
+ * @retval true if the reset was succesfull.
+ */
+bool msg_ring_reset(struct msg_ring *ring)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if(msg_ring_has_waiters(&ring->qp) || msg_ring_has_waiters(&ring->wq)) {
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return false;
+	}
+
+	ring->qp.qhead = NULL;
+	ring->wq.qhead = NULL;
+	ring->count = 0;
+	ring->wr_idx = 0;
+	ring->rd_idx = 0;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return true;
+}
+
+/**
+ * @brief Claim the slot at the tail of a message ring.
+ * @param ring Ring to claim the slot from.
+ * @return Index of the claimed slot.
+ * @note The caller must hold msg_ring::lock and make sure \p ring isn't full.
+ */
+uint8_t raw_msg_ring_push(struct msg_ring *ring)
+{
+	uint8_t idx;
+
+	idx = ring->wr_idx;
+	ring->wr_idx += 1;
+	if(ring->wr_idx >= ring->num)
+		ring->wr_idx = 0;
+	ring->count += 1;
+
+	return idx;
+}
+
+/**
+ * @brief Release the slot at the head of a message ring.
+ * @param ring Ring to release the slot from.
+ * @return Index of the released slot.
+ * @note The caller must hold msg_ring::lock and make sure \p ring isn't
+ *       empty. The slot can be read until the lock is released.
+ */
+uint8_t raw_msg_ring_pop(struct msg_ring *ring)
+{
+	uint8_t idx;
+
+	idx = ring->rd_idx;
+	ring->rd_idx += 1;
+	if(ring->rd_idx >= ring->num)
+		ring->rd_idx = 0;
+	ring->count -= 1;
+
+	return idx;
+}
+
+/**
+ * @brief Wait until a message ring holds a message.
+ * @param ring Ring to wait on.
+ * @param flags IRQ flags of msg_ring::lock.
+ * @param ms Maximum time to wait in miliseconds.
+ * @return An error code.
+ * @retval -EAGAIN if no message arrived within \p ms miliseconds. The lock
+ *                 has been released in that case.
+ * @note Call with msg_ring::lock held. On success it is held on return.
+ */
+int msg_ring_wait_msg(struct msg_ring *ring, unsigned long *flags,
+		unsigned ms)
+{
+	while(!ring->count) {
+		spin_unlock_irqrestore(&ring->lock, *flags);
+		if(raw_event_wait(&ring->qp, ms))
+			return -EAGAIN;
+
+		spin_lock_irqsave(&ring->lock, *flags);
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Wait for a free slot.
+ * @param ring Ring to wait on.
+ * @param ms Maximum time to wait in miliseconds.
+ * @return An error code.
+ * @retval -EAGAIN if no slot was released within \p ms miliseconds.
+ * @note The caller has to retry claiming a slot, another sender might
+ *       have claimed it first.
+ */
+int msg_ring_wait_slot(struct msg_ring *ring, unsigned ms)
+{
+	if(raw_event_wait(&ring->wq, ms))
+		return -EAGAIN;
+
+	return -EOK;
+}
+
+/**
+ * @brief Wake up the threads interested in a posted message.
+ * @param ring Ring a message has been posted to.
+ * @param room Whether \p ring still had a free slot after the post.
+ */
+void msg_ring_notify_post(struct msg_ring *ring, bool room)
+{
+	event_notify(&ring->qp);
+
+	/* Pass the remaining free slots on to the next waiting sender */
+	if(room && msg_ring_has_waiters(&ring->wq))
+		event_notify(&ring->wq);
+}
+
+/**
+ * @brief Wake up the threads interested in a received message.
+ * @param ring Ring messages have been taken from.
+ * @param was_full Whether \p ring was full before the messages were taken.
+ * @param more Whether \p ring still holds messages.
+ */
+void msg_ring_notify_get(struct msg_ring *ring, bool was_full, bool more)
+{
+	if(more && msg_ring_has_waiters(&ring->qp))
+		event_notify(&ring->qp);
+
+	/*
+	 * A sender that found the ring full might not be on the wait queue
+	 * yet, so always signal the wait queue when the ring was full.
+	 */
+	if(was_full || msg_ring_has_waiters(&ring->wq))
+		event_notify(&ring->wq);
+}
+
+/* @} */
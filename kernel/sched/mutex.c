@@ -29,12 +29,28 @@
 #include <etaos/mutex.h>
 #include <etaos/panic.h>
 
+#ifdef CONFIG_MUTEX_PI
+#include <etaos/sched.h>
+#endif
+
 #ifdef CONFIG_MUTEX_TRACE
 #include <etaos/trace.h>
 #endif
 
 #include <asm/pgm.h>
 
+/**
+ * @brief Check if there are threads waiting for a mutex.
+ * @param mutex Mutex to check.
+ * @return True if the queue of \p mutex holds waiting threads.
+ */
+static inline bool mutex_has_waiters(mutex_t *mutex)
+{
+	struct thread *tp = mutex->qp.qhead;
+
+	return tp && tp != SIGNALED;
+}
+
 /**
  * @brief Wait for a mutex to be signaled.
  * @param mutex Mutex lock.
@@ -65,6 +81,10 @@ int mutex_wait_tmo(mutex_t *mutex, unsigned int tmo)
  *
  * This function can be used recursively by the same thread without blocking. The
  * \p file and \p line arguments are used for mutex tracing.
+ *
+ * The owner and count are only touched with preemption disabled, which is
+ * enough to update them atomically. An uncontended lock doesn't touch the
+ * run queue or the event queue of \p mutex.
  */
 #ifdef CONFIG_MUTEX_TRACE
 void __mutex_lock(mutex_t *mutex, const char *file, int line)
@@ -75,7 +95,7 @@ void mutex_lock(mutex_t *mutex)
 	struct thread *tp = current_thread();
 
 	preempt_disable();
-	if(mutex->owner != tp) {
+	if(unlikely(mutex->owner && mutex->owner != tp)) {
 		while(mutex->count != 0)
 			raw_event_wait(&mutex->qp, EVENT_WAIT_INFINITE);
 	}
@@ -96,7 +116,8 @@ void mutex_lock(mutex_t *mutex)
  * @see mutex_lock
  * @see mutex_unlock_irq
  *
- * The \p file and \p line arguments are used for mutex tracing.
+ * The \p file and \p line arguments are used for mutex tracing. The event
+ * queue of \p mutex is only signaled if there are threads waiting for it.
  */
 #ifdef CONFIG_MUTEX_TRACE
 void __mutex_unlock(mutex_t *mutex, const char *file, int line)
@@ -125,11 +146,147 @@ void mutex_unlock(mutex_t *mutex)
 		trace_unset(&mutex->trace);
 #endif
 		mutex->owner = NULL;
-		event_notify(&mutex->qp);
+		if(mutex_has_waiters(mutex))
+			event_notify(&mutex->qp);
+	}
+
+	preempt_enable();
+}
+
+#ifdef CONFIG_MUTEX_PI
+/**
+ * @brief Pass the priority of a waiter on to the owner of a mutex.
+ * @param mutex Mutex \p tp is about to wait for.
+ * @param tp Waiting thread.
+ * @note Preemption should be disabled.
+ *
+ * If the owner is waiting for another PI mutex itself, the priority is
+ * passed on along the chain of owners.
+ */
+static void raw_mutex_pi_boost(mutex_t *mutex, struct thread *tp)
+{
+	struct thread *owner;
+	unsigned char p;
+
+	p = prio(tp);
+	while(mutex) {
+		owner = mutex->owner;
+		if(!owner || prio(owner) <= p)
+			break;
+
+		sched_set_prio(owner, p);
+		mutex = owner->pi_blocked_on;
+	}
+}
+
+/**
+ * @brief Move the highest priority waiter to the head of a wait queue.
+ * @param mutex Mutex of which the wait queue should be updated.
+ * @note Preemption should be disabled.
+ *
+ * Wait queues are FIFO ordered, while the priority of a waiter can still
+ * change when it inherits a priority itself. The waiter to wake up is
+ * therefore picked when \p mutex is released. The waiters in front of it
+ * are moved to the tail of the queue.
+ */
+static void raw_mutex_pi_promote(mutex_t *mutex)
+{
+	struct thread_queue *qp = &mutex->qp;
+	struct thread *walker, *top;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&qp->lock, flags);
+	if(!mutex_has_waiters(mutex)) {
+		raw_spin_unlock_irqrestore(&qp->lock, flags);
+		return;
+	}
+
+	top = qp->qhead;
+	walker = qp->sched_class->thread_after(top);
+	for(; walker; walker = qp->sched_class->thread_after(walker)) {
+		if(prio(walker) < prio(top))
+			top = walker;
+	}
+
+	while(qp->qhead != top) {
+		walker = qp->qhead;
+		raw_queue_remove_thread(qp, walker);
+		raw_queue_add_thread(qp, walker);
+	}
+	raw_spin_unlock_irqrestore(&qp->lock, flags);
+}
+
+/**
+ * @brief Lock a priority inheritance mutex.
+ * @param mutex Mutex to lock.
+ * @see mutex_unlock_pi
+ *
+ * Unlike mutex_lock, preemption stays enabled while \p mutex is held. If
+ * \p mutex is contended, its owner inherits the priority of the waiting
+ * thread until it releases \p mutex. This function can be used recursively
+ * by the same thread without blocking.
+ */
+void mutex_lock_pi(mutex_t *mutex)
+{
+	struct thread *tp = current_thread();
+
+	preempt_disable();
+	if(mutex->owner != tp) {
+		while(unlikely(mutex->count != 0)) {
+			raw_mutex_pi_boost(mutex, tp);
+			tp->pi_blocked_on = mutex;
+			raw_event_wait(&mutex->qp, EVENT_WAIT_INFINITE);
+		}
+
+		tp->pi_blocked_on = NULL;
+		tp->pi_held++;
+	}
+
+	mutex->count++;
+	mutex->owner = tp;
+	preempt_enable();
+}
+
+/**
+ * @brief Unlock a priority inheritance mutex.
+ * @param mutex Mutex to unlock.
+ * @see mutex_lock_pi
+ *
+ * Inherited priorities are dropped when the last PI mutex held by the
+ * current thread is released.
+ */
+void mutex_unlock_pi(mutex_t *mutex)
+{
+	struct thread *tp = current_thread();
+	bool restore;
+
+	if(mutex->owner != tp)
+		panic("Faulty mutex unlock!");
+
+	preempt_disable();
+	mutex->count -= 1;
+	if(mutex->count) {
+		preempt_enable();
+		return;
 	}
 
+	mutex->owner = NULL;
+	tp->pi_held--;
+
+	restore = !tp->pi_held && tp->prio != tp->base_prio;
+	if(restore)
+		sched_set_prio(tp, tp->base_prio);
+
+	if(mutex_has_waiters(mutex)) {
+		raw_mutex_pi_promote(mutex);
+		event_notify(&mutex->qp);
+	}
 	preempt_enable();
+
+	if(restore)
+		yield();
 }
+#endif
 
 /**
  * @brief Signal a mutex from IRQ context.
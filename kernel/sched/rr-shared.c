@@ -102,3 +102,149 @@ int rr_shared_queue_remove(struct thread *volatile*tpp,
 	return err;
 }
 
+
+#ifdef CONFIG_RR_PRIO_BITMAP
+/**
+ * @brief Link a thread into a priority level.
+ * @param rr Run queue to insert into.
+ * @param tp Thread to insert.
+ * @param level Priority level to insert \p tp into.
+ * @param prev Thread to insert \p tp after, \p NULL to insert at the head.
+ */
+static void rr_prio_rq_link(struct rr_rq *rr, struct thread *tp,
+		unsigned char level, struct thread *prev)
+{
+	struct rr_prio_level *lvl;
+
+#ifdef CONFIG_EVENT_MUTEX
+	tp->ec = 0;
+#endif
+	lvl = &rr->levels[level];
+	tp->queue = &lvl->head;
+	tp->se.level = level;
+	tp->se.prev = prev;
+	tp->se.next = prev ? prev->se.next : lvl->head;
+
+	if(prev)
+		prev->se.next = tp;
+	else
+		lvl->head = tp;
+
+	if(tp->se.next)
+		tp->se.next->se.prev = tp;
+	else
+		lvl->tail = tp;
+
+	rr->bitmap[level / BITS_PER_LONG] |= 1UL << (level % BITS_PER_LONG);
+}
+
+/**
+ * @brief Insert a thread at the tail of a priority level.
+ * @param rr Run queue to insert into.
+ * @param tp Thread to insert.
+ * @param level Priority level to insert \p tp into.
+ * @note This function runs in constant time.
+ */
+void rr_prio_rq_insert(struct rr_rq *rr, struct thread *tp,
+		unsigned char level)
+{
+	rr_prio_rq_link(rr, tp, level, rr->levels[level].tail);
+}
+
+/**
+ * @brief Insert a thread into a priority level, sorted by priority.
+ * @param rr Run queue to insert into.
+ * @param tp Thread to insert.
+ * @param level Priority level to insert \p tp into.
+ *
+ * Threads of equal priority are kept in FIFO order. The level is searched
+ * from its tail, so inserting a thread with the lowest priority of its level
+ * (or into a level with a single priority) runs in constant time.
+ */
+void rr_prio_rq_insert_sorted(struct rr_rq *rr, struct thread *tp,
+		unsigned char level)
+{
+	struct thread *prev;
+
+	prev = rr->levels[level].tail;
+	while(prev && prio(prev) > prio(tp))
+		prev = prev->se.prev;
+
+	rr_prio_rq_link(rr, tp, level, prev);
+}
+
+/**
+ * @brief Remove a thread from a priority level.
+ * @param rr Run queue to remove from.
+ * @param tp Thread to remove.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p tp was not on \p rr.
+ * @note This function runs in constant time.
+ */
+int rr_prio_rq_remove(struct rr_rq *rr, struct thread *tp)
+{
+	struct rr_prio_level *lvl;
+	unsigned char level;
+
+	level = tp->se.level;
+	lvl = &rr->levels[level];
+
+	if(!tp->se.prev && lvl->head != tp)
+		return -EINVAL;
+
+	if(tp->se.prev)
+		tp->se.prev->se.next = tp->se.next;
+	else
+		lvl->head = tp->se.next;
+
+	if(tp->se.next)
+		tp->se.next->se.prev = tp->se.prev;
+	else
+		lvl->tail = tp->se.prev;
+
+	tp->se.next = NULL;
+	tp->se.prev = NULL;
+	tp->queue = NULL;
+
+	if(!lvl->head)
+		rr->bitmap[level / BITS_PER_LONG] &=
+			~(1UL << (level % BITS_PER_LONG));
+
+	return -EOK;
+}
+
+/**
+ * @brief Get the next runnable thread from a priority bitmap run queue.
+ * @param rr Run queue to search.
+ * @return The first runnable thread on the highest non-empty level.
+ * @retval NULL if no runnable thread was found.
+ *
+ * Threads on the run queue normally have the THREAD_RUNNING_FLAG set, so
+ * the first thread found is returned in constant time.
+ */
+struct thread *rr_prio_rq_next_runnable(struct rr_rq *rr)
+{
+	unsigned int idx;
+	unsigned long word;
+	int bit;
+	struct thread *runnable;
+
+	for(idx = 0; idx < RR_PRIO_WORDS; idx++) {
+		word = rr->bitmap[idx];
+
+		while(word) {
+			bit = ffs_long(word) - 1;
+			word &= ~(1UL << bit);
+			runnable = rr->levels[idx * BITS_PER_LONG + bit].head;
+
+			for(; runnable; runnable = runnable->se.next) {
+				if(test_bit(THREAD_RUNNING_FLAG,
+							&runnable->flags))
+					return runnable;
+			}
+		}
+	}
+
+	return NULL;
+}
+#endif
@@ -59,7 +59,11 @@ static void rr_thread_queue_remove(struct thread_queue *qp, struct thread *tp)
 static void rr_add_thread(struct rq *rq, struct thread *tp)
 {
 	rq->num++;
+#ifdef CONFIG_RR_PRIO_BITMAP
+	rr_prio_rq_insert_sorted(&rq->rr_rq, tp, rr_prio_to_level(prio(tp)));
+#else
 	rr_shared_queue_insert(&rq->rr_rq.run_queue, tp);
+#endif
 }
 
 /**
@@ -73,7 +77,12 @@ static int rr_rm_thread(struct rq *rq, struct thread *tp)
 {
 	int rc;
 
-	if((rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp)) == 0)
+#ifdef CONFIG_RR_PRIO_BITMAP
+	rc = rr_prio_rq_remove(&rq->rr_rq, tp);
+#else
+	rc = rr_shared_queue_remove(&rq->rr_rq.run_queue, tp);
+#endif
+	if(rc == 0)
 		rq->num--;
 	
 	return rc;
@@ -87,6 +96,9 @@ static int rr_rm_thread(struct rq *rq, struct thread *tp)
  */
 static struct thread *rr_next_runnable(struct rq *rq)
 {
+#ifdef CONFIG_RR_PRIO_BITMAP
+	return rr_prio_rq_next_runnable(&rq->rr_rq);
+#else
 	struct thread *runnable;
 
 	for(runnable = rq->rr_rq.run_queue; runnable; 
@@ -98,6 +110,7 @@ static struct thread *rr_next_runnable(struct rq *rq)
 	}
 	
 	return runnable;
+#endif
 }
 
 #ifdef CONFIG_PREEMPT
@@ -24,4 +24,13 @@ extern void rr_shared_queue_insert(struct thread *volatile*tpp,
 extern int rr_shared_queue_remove(struct thread *volatile*tpp, 
 		struct thread *tp);
 
+#ifdef CONFIG_RR_PRIO_BITMAP
+extern void rr_prio_rq_insert(struct rr_rq *rr, struct thread *tp,
+		unsigned char level);
+extern void rr_prio_rq_insert_sorted(struct rr_rq *rr, struct thread *tp,
+		unsigned char level);
+extern int rr_prio_rq_remove(struct rr_rq *rr, struct thread *tp);
+extern struct thread *rr_prio_rq_next_runnable(struct rr_rq *rr);
+#endif
+
 #endif
@@ -0,0 +1,212 @@
+/*
+ *  ETA/OS - Stack high water marks
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sched
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/preempt.h>
+#include <etaos/list.h>
+#include <etaos/string.h>
+#include <etaos/stdio.h>
+#include <etaos/panic.h>
+#include <etaos/init.h>
+
+#ifdef CONFIG_DRIVER_CORE
+#include <etaos/device.h>
+#include <etaos/vfs.h>
+#endif
+
+/**
+ * @brief Update the high water mark of a thread stack.
+ * @param tp Thread to scan the stack of.
+ * @return The peak stack usage of \p tp in bytes.
+ *
+ * Stacks grow down, towards stack_info::base. The stack is scanned from
+ * its base up to the first byte that doesn't hold the paint pattern, so
+ * the scan only touches the unused part of the stack.
+ */
+static size_t stack_scan(struct thread *tp)
+{
+	struct stack_info *info = &tp->stack;
+	const uint8_t *ptr, *end;
+	size_t used;
+
+	ptr = info->base;
+	if(!ptr)
+		return 0UL;
+
+	end = ptr + info->size;
+	while(ptr < end && *ptr == STACK_PAINT_BYTE)
+		ptr++;
+
+	used = (size_t)(end - ptr);
+	if(used > info->high_water)
+		info->high_water = used;
+
+	return info->high_water;
+}
+
+/**
+ * @brief Get the peak stack usage of a thread.
+ * @param tp Thread to get the peak stack usage of.
+ * @return The highest number of stack bytes \p tp has used so far.
+ * @note This function scans the unused part of the stack of \p tp.
+ */
+size_t thread_stack_high_water(struct thread *tp)
+{
+	if(!tp)
+		return 0UL;
+
+	return stack_scan(tp);
+}
+
+/**
+ * @brief Scan the stack of the next thread on the thread list.
+ * @note Should be called by the idle thread, with preemption disabled.
+ *
+ * A single stack is scanned each time the idle thread runs, which keeps
+ * the time spent in the idle loop short.
+ */
+void sched_stack_scan_idle(void)
+{
+	static unsigned char idx;
+	struct list_head *carriage;
+	unsigned char num = 0;
+
+	list_for_each(carriage, &thread_list) {
+		if(num++ == idx) {
+			stack_scan(list_entry(carriage, struct thread,
+						thread_entry));
+			idx++;
+			return;
+		}
+	}
+
+	idx = 0;
+}
+
+#ifdef CONFIG_STACK_CANARY
+/**
+ * @brief Check a thread stack for overflows.
+ * @param tp Thread to check.
+ * @note Should be called with the run queue lock held.
+ *
+ * The bottom STACK_CANARY_SIZE bytes of every stack should still hold the
+ * paint pattern. If they don't, the stack of \p tp has overflowed and the
+ * system panics.
+ */
+void raw_sched_stack_check(struct thread *tp)
+{
+	const uint8_t *base;
+	int idx;
+
+	base = tp->stack.base;
+	if(unlikely(!base))
+		return;
+
+	for(idx = 0; idx < STACK_CANARY_SIZE; idx++) {
+		if(unlikely(base[idx] != STACK_PAINT_BYTE))
+			panic("Stack overflow in thread %s!\n", tp->name);
+	}
+}
+#endif
+
+#ifdef CONFIG_DRIVER_CORE
+static int stacks_open(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_lock(dev);
+	return -EOK;
+}
+
+static int stacks_close(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_unlock(dev);
+	return -EOK;
+}
+
+/**
+ * @brief Read the stack usage report.
+ * @param file Device file.
+ * @param buf Buffer to store the report in.
+ * @param len Length of \p buf.
+ * @return The number of bytes written into \p buf.
+ *
+ * Every thread is reported on a single line, by name, followed by the size
+ * of its stack and its peak stack usage in bytes. All stacks are scanned
+ * when the report is generated.
+ */
+static int stacks_read(struct file *file, void *buf, size_t len)
+{
+	struct list_head *carriage;
+	struct thread *tp;
+	struct file out;
+	size_t used;
+
+	if(!len)
+		return 0;
+
+	memset(&out, 0, sizeof(out));
+	raw_vfs_init_buffered_file(&out, len - 1, buf);
+
+	preempt_disable();
+	list_for_each(carriage, &thread_list) {
+		tp = list_entry(carriage, struct thread, thread_entry);
+		used = stack_scan(tp);
+
+		fprintf(&out, "stack %s %u %u\n", tp->name,
+				(unsigned int)tp->stack.size,
+				(unsigned int)used);
+	}
+	preempt_enable();
+
+	((char*)buf)[out.index] = '\0';
+	return (int)out.index;
+}
+
+static struct dev_file_ops stacks_fops = {
+	.open = &stacks_open,
+	.close = &stacks_close,
+	.read = &stacks_read,
+};
+
+static struct device stacks_dev = {
+	.name = "stacks",
+};
+
+static void __used stacks_init(void)
+{
+	device_initialize(&stacks_dev, &stacks_fops);
+}
+
+device_init(stacks_init);
+#endif
+
+/** @} */
@@ -0,0 +1,338 @@
+/*
+ *  ETA/OS - Scheduler statistics
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sched
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/irq.h>
+#include <etaos/preempt.h>
+#include <etaos/list.h>
+#include <etaos/string.h>
+#include <etaos/stdio.h>
+#include <etaos/tick.h>
+#include <etaos/init.h>
+
+#ifdef CONFIG_HRTIMER
+#include <etaos/hrtimer.h>
+#endif
+
+#ifdef CONFIG_DRIVER_CORE
+#include <etaos/device.h>
+#include <etaos/vfs.h>
+#endif
+
+static struct sched_stats sched_stats;
+static tick_t sched_irq_stamp;
+
+/**
+ * @brief Get the current time stamp of the statistics clock.
+ * @return The cycle counter of the high resolution clock, or the system tick
+ *         if no high resolution clock is available.
+ *
+ * The tick counts of the clock sources don't advance while interrupts are
+ * disabled, so the hardware counter is read directly.
+ */
+tick_t sched_stats_clock(void)
+{
+#ifdef CONFIG_HRTIMER
+	if(hr_sys_clk)
+		return arch_hrtimer_cycles();
+#endif
+
+	return sys_tick;
+}
+
+/**
+ * @brief Take the wake up time stamp of a thread.
+ * @param tp Thread that is added to a run queue.
+ * @note Should be called with the run queue lock held.
+ *
+ * The time stamp is kept until the thread runs again, so waking up a thread
+ * that is already waiting for the CPU doesn't hide the earlier wake up.
+ */
+void raw_sched_stats_wakeup(struct thread *tp)
+{
+	if(!tp->stats.woken)
+		tp->stats.woken = sched_stats_clock();
+}
+
+/**
+ * @brief Account a context switch.
+ * @param prev Thread that loses the CPU.
+ * @param next Thread that receives the CPU.
+ * @note Should be called with the run queue lock held.
+ *
+ * The switch counts as voluntary when \p prev isn't runnable any more
+ * (it sleeps, waits or exits) and as involuntary when \p prev was preempted.
+ */
+void raw_sched_stats_switch(struct thread *prev, struct thread *next)
+{
+	tick_t now;
+	unsigned long latency;
+	struct thread_stats *stats;
+
+	now = sched_stats_clock();
+	sched_stats.switches++;
+
+	stats = &prev->stats;
+	stats->runtime += (unsigned long)(now - stats->last_run);
+	stats->woken = 0;
+	if(test_bit(THREAD_RUNNING_FLAG, &prev->flags))
+		stats->nivcsw++;
+	else
+		stats->nvcsw++;
+
+	stats = &next->stats;
+	stats->last_run = now;
+	if(!stats->woken)
+		return;
+
+	latency = (unsigned long)(now - stats->woken);
+	stats->woken = 0;
+	if(!stats->wakeups || latency < stats->lat_min)
+		stats->lat_min = latency;
+	if(latency > stats->lat_max)
+		stats->lat_max = latency;
+
+	stats->lat_total += latency;
+	stats->wakeups++;
+}
+
+/**
+ * @brief Take a time stamp when __schedule disables interrupts.
+ * @note Should be called with interrupts disabled.
+ */
+void raw_sched_stats_enter(void)
+{
+	sched_irq_stamp = sched_stats_clock();
+}
+
+/**
+ * @brief Account the time __schedule ran with interrupts disabled.
+ * @note Should be called before interrupts are enabled again.
+ *
+ * The time stamp is kept in a global variable, because the thread that
+ * leaves __schedule is not the thread that entered it when a context switch
+ * happened.
+ */
+void raw_sched_stats_exit(void)
+{
+	unsigned long delta;
+
+	delta = (unsigned long)(sched_stats_clock() - sched_irq_stamp);
+	sched_stats.schedules++;
+	sched_stats.irq_off_total += delta;
+	if(delta > sched_stats.irq_off_max)
+		sched_stats.irq_off_max = delta;
+}
+
+/**
+ * @brief Get a copy of the global scheduling statistics.
+ * @param stats Structure to copy the statistics into.
+ */
+void sched_get_stats(struct sched_stats *stats)
+{
+	unsigned long flags;
+
+	irq_save_and_disable(&flags);
+	memcpy(stats, &sched_stats, sizeof(*stats));
+	irq_restore(&flags);
+}
+
+/**
+ * @brief Get a copy of the scheduling statistics of a thread.
+ * @param tp Thread to get the statistics of.
+ * @param stats Structure to copy the statistics into.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p tp or \p stats is \p NULL.
+ *
+ * The runtime of the current thread includes its current time slice.
+ */
+int sched_get_thread_stats(struct thread *tp, struct thread_stats *stats)
+{
+	unsigned long flags;
+
+	if(!tp || !stats)
+		return -EINVAL;
+
+	irq_save_and_disable(&flags);
+	memcpy(stats, &tp->stats, sizeof(*stats));
+	if(tp == current_thread())
+		stats->runtime += (unsigned long)(sched_stats_clock() -
+				stats->last_run);
+	irq_restore(&flags);
+
+	return -EOK;
+}
+
+#ifdef CONFIG_DRIVER_CORE
+#define SCHED_STATS_LINE 96 //!< Maximum length of a report line.
+
+/**
+ * @brief Scheduling report being copied into a read buffer.
+ */
+struct sched_stats_report {
+	char *buf; //!< Read buffer.
+	size_t len; //!< Length of sched_stats_report::buf.
+	size_t pos; //!< Number of bytes stored in sched_stats_report::buf.
+	size_t skip; //!< Report bytes consumed by earlier reads.
+};
+
+/**
+ * @brief Add a line to a scheduling report.
+ * @param report Report to add to.
+ * @param fmt Format string of the line.
+ *
+ * The part of the line that has already been read is skipped, the part
+ * that doesn't fit in the read buffer is dropped.
+ */
+static void sched_stats_line(struct sched_stats_report *report,
+		const char *fmt, ...)
+{
+	char line[SCHED_STATS_LINE];
+	struct file out;
+	va_list args;
+	size_t num;
+
+	memset(&out, 0, sizeof(out));
+	raw_vfs_init_buffered_file(&out, sizeof(line), line);
+
+	va_start(args, fmt);
+	vfprintf(&out, fmt, args);
+	va_end(args);
+
+	num = out.index;
+	if(report->skip >= num) {
+		report->skip -= num;
+		return;
+	}
+
+	num -= report->skip;
+	if(num > report->len - report->pos)
+		num = report->len - report->pos;
+
+	memcpy(report->buf + report->pos, line + report->skip, num);
+	report->pos += num;
+	report->skip = 0;
+}
+
+static int sched_stats_open(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_lock(dev);
+	file->index = 0;
+	return -EOK;
+}
+
+static int sched_stats_close(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_unlock(dev);
+	return -EOK;
+}
+
+/**
+ * @brief Read the scheduling statistics.
+ * @param file Device file.
+ * @param buf Buffer to store the report in.
+ * @param len Length of \p buf.
+ * @return The number of bytes written into \p buf.
+ * @retval 0 if the entire report has been read.
+ *
+ * The report is formatted as text, one <i>key value</i> pair per line.
+ * Threads are reported by name, followed by their runtime, voluntary and
+ * involuntary context switches and the minimum, maximum and average wake up
+ * latency. Preemption is disabled while the thread list is walked, so
+ * threads can't be destroyed during the report.
+ *
+ * The report is generated on every read, starting at the file index. The
+ * index is advanced by the number of bytes read. Lines longer than
+ * SCHED_STATS_LINE are truncated.
+ */
+static int sched_stats_read(struct file *file, void *buf, size_t len)
+{
+	struct sched_stats_report report;
+	struct sched_stats stats;
+	struct thread_stats ts;
+	struct thread *tp;
+	struct list_head *carriage;
+	unsigned long avg;
+
+	if(!len)
+		return 0;
+
+	sched_get_stats(&stats);
+	avg = stats.schedules ? stats.irq_off_total / stats.schedules : 0;
+
+	report.buf = buf;
+	report.len = len;
+	report.pos = 0;
+	report.skip = file->index;
+
+	sched_stats_line(&report, "switches %lu\nschedules %lu\n",
+			stats.switches, stats.schedules);
+	sched_stats_line(&report, "irq_off_max %lu\nirq_off_avg %lu\n",
+			stats.irq_off_max, avg);
+
+	preempt_disable();
+	list_for_each(carriage, &thread_list) {
+		tp = list_entry(carriage, struct thread, thread_entry);
+		sched_get_thread_stats(tp, &ts);
+		avg = ts.wakeups ? ts.lat_total / ts.wakeups : 0;
+
+		sched_stats_line(&report, "thread %s %lu %lu %lu %lu %lu %lu\n",
+				tp->name, (unsigned long)ts.runtime, ts.nvcsw,
+				ts.nivcsw, ts.lat_min, ts.lat_max, avg);
+	}
+	preempt_enable();
+
+	file->index += report.pos;
+	return (int)report.pos;
+}
+
+static struct dev_file_ops sched_stats_fops = {
+	.open = &sched_stats_open,
+	.close = &sched_stats_close,
+	.read = &sched_stats_read,
+};
+
+static struct device sched_stats_dev = {
+	.name = "sched",
+};
+
+static void __used sched_stats_init(void)
+{
+	device_initialize(&sched_stats_dev, &sched_stats_fops);
+}
+
+device_init(sched_stats_init);
+#endif
+
+/** @} */
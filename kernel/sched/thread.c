@@ -32,10 +32,47 @@
 #include <etaos/irq.h>
 #include <etaos/spinlock.h>
 #include <etaos/mem.h>
+#include <etaos/mempool.h>
 #include <etaos/bitops.h>
 #include <etaos/string.h>
 #include <etaos/list.h>
 
+#ifdef CONFIG_THREAD_LIST
+/**
+ * @brief List of all threads in the system.
+ *
+ * Walk this list with preemption disabled, threads are only removed from
+ * it when they are destroyed by the scheduler.
+ */
+struct list_head thread_list = STATIC_INIT_LIST_HEAD(thread_list);
+
+/**
+ * @brief Add a thread to the thread list.
+ * @param tp Thread to add.
+ */
+void thread_list_add(struct thread *tp)
+{
+	unsigned long flags;
+
+	irq_save_and_disable(&flags);
+	list_add_tail(&tp->thread_entry, &thread_list);
+	irq_restore(&flags);
+}
+
+/**
+ * @brief Remove a thread from the thread list.
+ * @param tp Thread to remove.
+ */
+void thread_list_del(struct thread *tp)
+{
+	unsigned long flags;
+
+	irq_save_and_disable(&flags);
+	list_del(&tp->thread_entry);
+	irq_restore(&flags);
+}
+#endif
+
 /**
  * @brief Thread initialise backend.
  * @param tp Thread pointer.
@@ -71,14 +108,17 @@ static void raw_thread_init(struct thread *tp, const char *name,
 #ifdef CONFIG_DYN_PRIO
 	tp->dprio = 0;
 #endif
-#ifdef CONFIG_SYS_LOTTERY
-	list_head_init(&tp->se.tickets);
+#ifdef CONFIG_MUTEX_PI
+	tp->base_prio = prio;
+	tp->pi_held = 0;
+	tp->pi_blocked_on = NULL;
 #endif
 #ifdef CONFIG_EXTENDED_THREAD
 	thread_queue_init(&tp->joinq);
 #endif
 
 	list_head_init(&tp->entry);
+	thread_list_add(tp);
 	irq_store_flags(&tp->irq_state);
 	sched_create_stack_frame(tp, stack, stack_size, handle);
 
@@ -104,6 +144,44 @@ void sched_init_idle(struct thread *tp, const char *name,
 	set_bit(THREAD_SYSTEM_STACK, &tp->flags);
 }
 
+#ifdef CONFIG_THREAD_POOL
+DEFINE_MEM_POOL(thread_pool, sizeof(struct thread), CONFIG_THREAD_POOL_SIZE);
+#endif
+
+/**
+ * @brief Allocate a zero initialised thread structure.
+ * @return The allocated thread or \p NULL.
+ *
+ * Threads are taken from the thread pool if possible. The heap is used
+ * when the pool is exhausted.
+ */
+static struct thread *thread_obj_alloc(void)
+{
+#ifdef CONFIG_THREAD_POOL
+	struct thread *tp;
+
+	tp = mem_pool_zalloc(&thread_pool);
+	if(tp)
+		return tp;
+#endif
+
+	return kzalloc(sizeof(struct thread));
+}
+
+/**
+ * @brief Free a thread structure allocated by thread_obj_alloc.
+ * @param tp Thread structure to free.
+ */
+static void thread_obj_free(struct thread *tp)
+{
+#ifdef CONFIG_THREAD_POOL
+	if(mem_pool_free(&thread_pool, tp) == -EOK)
+		return;
+#endif
+
+	kfree(tp);
+}
+
 /**
  * @brief Allocate and start a new thread.
  * @param name Thread name.
@@ -111,20 +189,42 @@ void sched_init_idle(struct thread *tp, const char *name,
  * @param arg Thread argument.
  * @param attr Thread attributes.
  * @return The allocated thread.
+ * @retval NULL if the thread could not be created.
  */
 struct thread *thread_create(const char *name, thread_handle_t handle,
 		void *arg, thread_attr_t *attr)
 {
 	struct thread *tp;
 
-	tp = kzalloc(sizeof(*tp));
+	tp = thread_obj_alloc();
 	if(!tp)
 		return NULL;
 
-	thread_init(tp, name, handle, arg, attr);
+	if(thread_init(tp, name, handle, arg, attr)) {
+		thread_obj_free(tp);
+		return NULL;
+	}
+
 	return tp;
 }
 
+/**
+ * @brief Add an initialised thread to a run queue.
+ * @param tp Thread to add.
+ * @return An error code.
+ */
+static int thread_enqueue(struct thread *tp)
+{
+	struct rq *rq;
+
+	rq = sched_select_rq();
+
+	preempt_disable();
+	rq_add_thread(rq, tp);
+	preempt_enable();
+	return -EOK;
+}
+
 /**
  * @brief Initialise a new thread.
  * @param tp The thread pointer to initialise.
@@ -141,7 +241,12 @@ int thread_init(struct thread *tp, const char *name, thread_handle_t handle,
 	void *stack;
 	unsigned char prio;
 	bool alloc = false;
+#ifdef CONFIG_EDF
 	int rv;
+#endif
+
+	if(!tp)
+		return -EINVAL;
 
 	prio = 0;
 	stack_size = 0;
@@ -164,12 +269,24 @@ int thread_init(struct thread *tp, const char *name, thread_handle_t handle,
 		alloc = true;
 	}
 
-	rv = thread_initialise(tp, name, handle, arg, stack_size, stack, prio);
-
+	raw_thread_init(tp, name, handle, arg, stack_size, stack, prio);
 	if(alloc)
 		set_bit(THREAD_SYSTEM_STACK, &tp->flags);
 
-	return rv;
+#ifdef CONFIG_EDF
+	if(attr) {
+		rv = edf_set_params(tp, attr->period, attr->deadline,
+				attr->wcet);
+		if(rv) {
+			thread_list_del(tp);
+			if(alloc)
+				kfree(stack);
+			return rv;
+		}
+	}
+#endif
+
+	return thread_enqueue(tp);
 }
 
 /**
@@ -180,6 +297,7 @@ int thread_init(struct thread *tp, const char *name, thread_handle_t handle,
  * @param attr Thread attributes.
  * @return The allocated thread.
  * @note The thread \p tp is not started.
+ * @note Invalid EDF parameters in \p attr are ignored.
  * @see thread_start
  */
 struct thread *thread_alloc(const char *name, thread_handle_t handle,
@@ -189,7 +307,7 @@ struct thread *thread_alloc(const char *name, thread_handle_t handle,
 	size_t stack_size;
 	void *stack;
 	unsigned char prio;
-	bool alloc;
+	bool alloc = false;
 
 	if(attr) {
 		prio = attr->prio;
@@ -200,7 +318,7 @@ struct thread *thread_alloc(const char *name, thread_handle_t handle,
 		stack_size = 0;
 		stack = NULL;
 	}
-	tp = kzalloc(sizeof(*tp));
+	tp = thread_obj_alloc();
 
 	if(!tp)
 		return NULL;
@@ -221,6 +339,11 @@ struct thread *thread_alloc(const char *name, thread_handle_t handle,
 	if(alloc)
 		set_bit(THREAD_SYSTEM_STACK, &tp->flags);
 
+#ifdef CONFIG_EDF
+	if(attr)
+		edf_set_params(tp, attr->period, attr->deadline, attr->wcet);
+#endif
+
 	return tp;
 }
 
@@ -260,18 +383,11 @@ int thread_initialise(struct thread *tp, const char *name,
 		thread_handle_t handle, void *arg, size_t stack_size,
 		void *stack, unsigned char prio)
 {
-	struct rq *rq;
-
 	if(!tp)
 		return -EINVAL;
 
 	raw_thread_init(tp, name, handle, arg, stack_size, stack, prio);
-	rq = sched_select_rq();
-
-	preempt_disable();
-	rq_add_thread(rq, tp);
-	preempt_enable();
-	return -EOK;
+	return thread_enqueue(tp);
 }
 
 /**
@@ -420,8 +536,19 @@ unsigned char nice(unsigned char prio)
 		prio = 254;
 
 	tp = current_thread();
+#ifdef CONFIG_MUTEX_PI
+	/*
+	 * While boosted, only the base priority is changed. It is applied
+	 * when the last PI mutex is released.
+	 */
+	old = tp->base_prio;
+	tp->base_prio = prio;
+	if(!tp->pi_held)
+		sched_set_prio(tp, prio);
+#else
 	old = tp->prio;
 	tp->prio = prio;
+#endif
 	yield();
 
 	return old;
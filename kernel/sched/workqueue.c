@@ -0,0 +1,345 @@
+/*
+ *  ETA/OS - Work queues
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup workqueue
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/event.h>
+#include <etaos/spinlock.h>
+#include <etaos/string.h>
+#include <etaos/timer.h>
+#include <etaos/workqueue.h>
+#include <etaos/init.h>
+
+/**
+ * @brief Worker thread descriptor.
+ *
+ * Work is processed in FIFO order per worker. The pending list is singly
+ * linked, so the statically allocated workers need no run time
+ * initialisation and work can be queued before the worker threads exist.
+ */
+struct worker {
+	struct work *head; //!< First pending work item.
+	struct work *tail; //!< Last pending work item.
+	struct thread_queue wq; //!< Wait queue of the worker thread.
+	spinlock_t lock; //!< Pending list lock.
+	struct thread *tp; //!< Worker thread.
+};
+
+#if CONFIG_WORKQUEUE_WORKERS > 1
+#define WORKER_PRIO_STEP ((SCHED_DEFAULT_PRIO - SCHED_HIGH_PRIO) / \
+		(CONFIG_WORKQUEUE_WORKERS - 1))
+#else
+#define WORKER_PRIO_STEP 0
+#endif
+
+static struct worker workers[CONFIG_WORKQUEUE_WORKERS] = {
+	[0 ... CONFIG_WORKQUEUE_WORKERS - 1] = {
+		.head = NULL,
+		.tail = NULL,
+		.wq = INIT_THREAD_QUEUE,
+		.lock = STATIC_SPIN_LOCK_INIT,
+		.tp = NULL,
+	},
+};
+
+/**
+ * @brief Initialise a work item.
+ * @param work Work item to initialise.
+ * @param handle Work handler.
+ * @param arg Argument to \p handle.
+ * @param level Worker level, ranging from WORK_HIGH_PRIO to WORK_LOW_PRIO.
+ *
+ * Levels beyond WORK_LOW_PRIO are handled by the lowest priority worker.
+ */
+void work_init(struct work *work, work_handle_t handle, void *arg,
+		unsigned char level)
+{
+	if(level > WORK_LOW_PRIO)
+		level = WORK_LOW_PRIO;
+
+	work->next = NULL;
+	work->handle = handle;
+	work->arg = arg;
+	work->level = level;
+	work->pending = false;
+}
+
+/**
+ * @brief Append a work item to the pending list of its worker.
+ * @param worker Worker to queue \p work on.
+ * @param work Work item to queue.
+ * @note Should be called with the worker lock held.
+ */
+static void raw_worker_add(struct worker *worker, struct work *work)
+{
+	work->next = NULL;
+	if(worker->tail)
+		worker->tail->next = work;
+	else
+		worker->head = work;
+
+	worker->tail = work;
+}
+
+/**
+ * @brief Remove a work item from the pending list of its worker.
+ * @param worker Worker \p work is queued on.
+ * @param work Work item to remove.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p work isn't queued on \p worker.
+ * @note Should be called with the worker lock held.
+ */
+static int raw_worker_remove(struct worker *worker, struct work *work)
+{
+	struct work *prev = NULL, *walker;
+
+	for(walker = worker->head; walker; walker = walker->next) {
+		if(walker == work)
+			break;
+		prev = walker;
+	}
+
+	if(!walker)
+		return -EINVAL;
+
+	if(prev)
+		prev->next = work->next;
+	else
+		worker->head = work->next;
+
+	if(worker->tail == work)
+		worker->tail = prev;
+
+	work->next = NULL;
+	return -EOK;
+}
+
+/**
+ * @brief Queue a work item on its worker.
+ * @param work Work item to queue.
+ * @note struct work::pending should already be set.
+ */
+static void worker_enqueue(struct work *work)
+{
+	struct worker *worker = &workers[work->level];
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&worker->lock, flags);
+	raw_worker_add(worker, work);
+	raw_spin_unlock_irqrestore(&worker->lock, flags);
+}
+
+/**
+ * @brief Mark a work item as pending.
+ * @param work Work item to mark.
+ * @return True if \p work was not pending yet.
+ */
+static bool work_set_pending(struct work *work)
+{
+	unsigned long flags;
+	bool rv;
+
+	irq_save_and_disable(&flags);
+	rv = !work->pending;
+	work->pending = true;
+	irq_restore(&flags);
+
+	return rv;
+}
+
+/**
+ * @brief Queue a work item.
+ * @param work Work item to queue.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EBUSY if \p work is already pending.
+ *
+ * This function can be called from IRQ context. A work item can be queued
+ * again once its handler has started.
+ */
+int queue_work(struct work *work)
+{
+	if(!work_set_pending(work))
+		return -EBUSY;
+
+	worker_enqueue(work);
+	event_notify(&workers[work->level].wq);
+	return -EOK;
+}
+
+/**
+ * @brief Delay timer handler.
+ * @param timer Delay timer.
+ * @param arg Delayed work item.
+ *
+ * Timers are processed by the scheduler with the run queue locked, so the
+ * worker is woken up the same way an IRQ would wake it up.
+ */
+static void delayed_work_timeout(struct timer *timer, void *arg)
+{
+	struct delayed_work *dwork = arg;
+
+	worker_enqueue(&dwork->work);
+	event_notify_irq(&workers[dwork->work.level].wq);
+}
+
+/**
+ * @brief Initialise a delayed work item.
+ * @param dwork Delayed work item to initialise.
+ * @param handle Work handler.
+ * @param arg Argument to \p handle.
+ * @param level Worker level, ranging from WORK_HIGH_PRIO to WORK_LOW_PRIO.
+ */
+void delayed_work_init(struct delayed_work *dwork, work_handle_t handle,
+		void *arg, unsigned char level)
+{
+	work_init(&dwork->work, handle, arg, level);
+	timer_init_static(&dwork->timer, sched_get_clock(),
+			&delayed_work_timeout, dwork, TIMER_ONESHOT_MASK);
+}
+
+/**
+ * @brief Queue a work item after a delay.
+ * @param dwork Delayed work item to queue.
+ * @param ms Delay in miliseconds.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EBUSY if \p dwork is already pending.
+ * @retval -ENOMEM if the delay timer couldn't be armed.
+ *
+ * The work item is queued on its worker when the delay expires. A delay
+ * of 0 queues the work item immediately.
+ */
+int queue_delayed_work(struct delayed_work *dwork, unsigned ms)
+{
+	int rv;
+
+	if(!ms)
+		return queue_work(&dwork->work);
+
+	if(!work_set_pending(&dwork->work))
+		return -EBUSY;
+
+	rv = timer_arm(&dwork->timer, ms);
+	if(rv)
+		dwork->work.pending = false;
+
+	return rv;
+}
+
+/**
+ * @brief Cancel a pending work item.
+ * @param work Work item to cancel.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p work is not queued.
+ * @note A handler that is already running is not waited for.
+ */
+int cancel_work(struct work *work)
+{
+	struct worker *worker = &workers[work->level];
+	unsigned long flags;
+	int rv;
+
+	raw_spin_lock_irqsave(&worker->lock, flags);
+	rv = raw_worker_remove(worker, work);
+	if(!rv)
+		work->pending = false;
+	raw_spin_unlock_irqrestore(&worker->lock, flags);
+
+	return rv;
+}
+
+/**
+ * @brief Cancel a pending delayed work item.
+ * @param dwork Delayed work item to cancel.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p dwork is not pending.
+ */
+int cancel_delayed_work(struct delayed_work *dwork)
+{
+	if(timer_disarm(&dwork->timer) == -EOK) {
+		dwork->work.pending = false;
+		return -EOK;
+	}
+
+	return cancel_work(&dwork->work);
+}
+
+/**
+ * @brief Worker thread.
+ * @param arg Worker descriptor.
+ */
+THREAD(worker_thread, arg)
+{
+	struct worker *worker = arg;
+	struct work *work;
+	unsigned long flags;
+
+	while(true) {
+		raw_spin_lock_irqsave(&worker->lock, flags);
+		work = worker->head;
+		if(work) {
+			raw_worker_remove(worker, work);
+			work->pending = false;
+		}
+		raw_spin_unlock_irqrestore(&worker->lock, flags);
+
+		if(!work) {
+			raw_event_wait(&worker->wq, 0);
+			continue;
+		}
+
+		work->handle(work, work->arg);
+	}
+}
+
+/**
+ * @brief Start the worker threads.
+ *
+ * The first worker runs at SCHED_HIGH_PRIO, the priorities of the other
+ * workers are spread evenly up to SCHED_DEFAULT_PRIO.
+ */
+static void __used workqueue_init(void)
+{
+	thread_attr_t attr;
+	int idx;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.stack_size = CONFIG_WORKQUEUE_STACK_SIZE;
+
+	for(idx = 0; idx < CONFIG_WORKQUEUE_WORKERS; idx++) {
+		attr.prio = SCHED_HIGH_PRIO + idx * WORKER_PRIO_STEP;
+		workers[idx].tp = thread_create("worker", &worker_thread,
+				&workers[idx], &attr);
+	}
+}
+
+module_init(workqueue_init);
+
+/** @} */
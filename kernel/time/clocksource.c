@@ -27,6 +27,7 @@
 #include <etaos/list.h>
 #include <etaos/error.h>
 #include <etaos/clocksource.h>
+#include <etaos/timer.h>
 #include <etaos/time.h>
 #include <etaos/string.h>
 
@@ -38,6 +39,7 @@ static struct list_head sources = STATIC_INIT_LIST_HEAD(sources);
  * @param cs Clock source which has to be initialised.
  * @param freq Frequency of the clock source.
  * @return An error code.
+ * @retval -ENOMEM if the timer wheel of \p cs couldn't be allocated.
  */
 int clocksource_init(const char *name, struct clocksource *cs, unsigned long freq)
 {
@@ -45,13 +47,20 @@ int clocksource_init(const char *name, struct clocksource *cs, unsigned long fre
 		return -EINVAL;
 
 	cs->thead = NULL;
+#ifdef CONFIG_TIMER_WHEEL
+	cs->wheel = NULL;
+#endif
 	cs->name = name;
 	cs->freq = freq;
 	cs->count = 0UL;
 	cs->tc_update = 0UL;
 	spinlock_init(&cs->lock);
-	list_add(&cs->list, &sources);
 	list_head_init(&cs->timers);
+#ifdef CONFIG_TIMER_WHEEL
+	if(timer_wheel_init(cs) != -EOK)
+		return -ENOMEM;
+#endif
+	list_add(&cs->list, &sources);
 	return -EOK;
 }
 
@@ -46,6 +46,9 @@ static irqreturn_t timer_irq_handle(struct irq_data *irq, void *data)
 {
 	struct clocksource *cs = (struct clocksource*)data;
 
+	if(tick_nohz_irq())
+		return IRQ_HANDLED; /* Skipped ticks are handled by nohz */
+
 	time_inc(); /* Handle system time */
 	timer_source_inc(cs); /* Increase the system / sched clock */
 	sched_clock_tick((1.0f / cs->freq) * 1000);
@@ -0,0 +1,123 @@
+/*
+ *  ETA/OS - Tickless idle
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file kernel/time/nohz.c
+ * @addtogroup tm
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/irq.h>
+#include <etaos/time.h>
+#include <etaos/timer.h>
+#include <etaos/tick.h>
+#include <etaos/power.h>
+#include <etaos/preempt.h>
+#include <etaos/limits.h>
+
+static volatile unsigned long nohz_ticks;
+static volatile bool nohz_expired;
+
+/**
+ * @brief Check if the system tick is stopped.
+ * @return True if the tick is stopped, false otherwise.
+ * @note This function should be called from the system tick IRQ.
+ *
+ * When the system tick is stopped, the next tick IRQ marks the end of the
+ * tickless period. The skipped ticks are accounted for by tick_nohz_idle.
+ */
+bool tick_nohz_irq(void)
+{
+	if(!nohz_ticks)
+		return false;
+
+	nohz_expired = true;
+	return true;
+}
+
+/**
+ * @brief Catch the system clock up with the ticks that were skipped.
+ * @param cs Clocksource to update.
+ * @param ticks Number of ticks that were skipped.
+ */
+static void tick_nohz_catch_up(struct clocksource *cs, unsigned long ticks)
+{
+	timer_source_add(cs, ticks);
+
+	while(ticks--)
+		time_inc();
+}
+
+/**
+ * @brief Put the CPU to sleep until the next timer expires.
+ * @param cs Clocksource driving the system tick.
+ * @note The power mode should be selected before calling this function.
+ *
+ * The system tick is reprogrammed to fire at (or before) the first timer
+ * expiry on \p cs. After the CPU wakes up, either by the tick or by another
+ * IRQ, the periodic tick is restarted and \p cs is updated with the number
+ * of ticks that have passed.
+ *
+ * The CPU doesn't go to sleep if a thread was woken up after the idle thread
+ * last ran the scheduler. The check is done with interrupts disabled and the
+ * interrupts are only enabled again by the instruction that puts the CPU to
+ * sleep, so a wakeup can't be missed.
+ */
+void tick_nohz_idle(struct clocksource *cs)
+{
+	unsigned long flags, ticks, elapsed;
+	time_t next, now;
+
+	irq_save_and_disable(&flags);
+	if(should_resched()) {
+		irq_restore(&flags);
+		return;
+	}
+
+	now = clocksource_get_tick(cs);
+	next = timer_next_expiry(cs);
+
+	if(next == NEVER)
+		ticks = ULONG_MAX;
+	else if(time_after(next, now))
+		ticks = next - now;
+	else
+		ticks = 0;
+
+	if(ticks <= 1) {
+		hibernate_irq_enable();
+		return;
+	}
+
+	nohz_expired = false;
+	nohz_ticks = arch_tick_suspend(ticks);
+	hibernate_irq_enable();
+
+	if(!nohz_ticks)
+		return;
+
+	irq_save_and_disable(&flags);
+	elapsed = arch_tick_resume(nohz_expired);
+	nohz_ticks = 0;
+	tick_nohz_catch_up(cs, elapsed);
+	irq_restore(&flags);
+}
+
+/** @} */
@@ -0,0 +1,266 @@
+/*
+ *  ETA/OS - Hierarchical timer wheel
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file kernel/time/timer-wheel.c
+ * @addtogroup tm
+ * @{
+ *
+ * The timer wheel stores virtual timers in CONFIG_TIMER_WHEEL_LEVELS levels
+ * of TIMER_WHEEL_SIZE slots each. Level 0 has a resolution of a single
+ * clocksource tick, every next level is TIMER_WHEEL_SIZE times coarser.
+ * Timers are inserted in constant time into the slot matching their expiry
+ * time. Every time the lower level wraps around, the matching slot of the
+ * next level is cascaded down.
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/list.h>
+#include <etaos/error.h>
+#include <etaos/timer.h>
+#include <etaos/mem.h>
+#include <etaos/tick.h>
+
+#if CONFIG_TIMER_WHEEL_BITS * CONFIG_TIMER_WHEEL_LEVELS > 32
+#error "The timer wheel can't cover more than 32 bits of ticks"
+#endif
+
+/**
+ * @brief Get the slot index of a time stamp on a given level.
+ * @param __t Time stamp.
+ * @param __l Wheel level.
+ */
+#define timer_wheel_index(__t, __l) \
+	(((unsigned long)(__t) >> ((__l) * CONFIG_TIMER_WHEEL_BITS)) & \
+	 TIMER_WHEEL_MASK)
+
+/**
+ * @brief Total number of ticks covered by the wheel.
+ */
+#define TIMER_WHEEL_RANGE \
+	(1ULL << (CONFIG_TIMER_WHEEL_LEVELS * CONFIG_TIMER_WHEEL_BITS))
+
+/**
+ * @brief Allocate and initialise a timer wheel.
+ * @param cs Clocksource to create the wheel for.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -ENOMEM if no memory is available.
+ * @note Called by clocksource_init, so arming a timer never has to allocate
+ *       memory.
+ */
+int timer_wheel_init(struct clocksource *cs)
+{
+	struct timer_wheel *wheel;
+	int level, slot;
+
+	if(cs->wheel)
+		return -EOK;
+
+	wheel = kzalloc(sizeof(*wheel));
+	if(!wheel)
+		return -ENOMEM;
+
+	for(level = 0; level < CONFIG_TIMER_WHEEL_LEVELS; level++) {
+		for(slot = 0; slot < TIMER_WHEEL_SIZE; slot++)
+			list_head_init(&wheel->vec[level][slot]);
+	}
+
+	wheel->clk = clocksource_get_tick(cs);
+	wheel->pending = 0UL;
+	cs->wheel = wheel;
+
+	return -EOK;
+}
+
+/**
+ * @brief Insert a timer into the timer wheel.
+ * @param wheel Wheel to insert into.
+ * @param timer Timer to insert.
+ * @note This function runs in constant time.
+ */
+static void __timer_wheel_insert(struct timer_wheel *wheel,
+		struct timer *timer)
+{
+	time_t expire, delta;
+	int level;
+
+	expire = timer->expire_at;
+	delta = expire - (time_t)wheel->clk;
+
+	if(delta < 0) {
+		/* Already expired, run it on the next tick */
+		expire = wheel->clk;
+		delta = 0;
+	} else if(delta >= (time_t)TIMER_WHEEL_RANGE) {
+		/* Park it at the far end, it will be cascaded again */
+		delta = TIMER_WHEEL_RANGE - 1;
+		expire = wheel->clk + delta;
+	}
+
+	for(level = 0; level < CONFIG_TIMER_WHEEL_LEVELS - 1; level++) {
+		if(delta < (time_t)(1ULL << ((level + 1) *
+						CONFIG_TIMER_WHEEL_BITS)))
+			break;
+	}
+
+	list_add_tail(&timer->entry,
+			&wheel->vec[level][timer_wheel_index(expire, level)]);
+}
+
+/**
+ * @brief Insert a timer into the timer wheel of its clocksource.
+ * @param cs Clocksource to insert into.
+ * @param timer Timer to insert.
+ * @note No locks are aquired.
+ */
+void raw_timer_wheel_insert(struct clocksource *cs, struct timer *timer)
+{
+	struct timer_wheel *wheel = cs->wheel;
+
+	__timer_wheel_insert(wheel, timer);
+	wheel->pending++;
+}
+
+/**
+ * @brief Remove a timer from the timer wheel.
+ * @param cs Clocksource \p timer is running on.
+ * @param timer Timer to remove.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p timer wasn't on the wheel.
+ * @note No locks are aquired.
+ */
+int raw_timer_wheel_remove(struct clocksource *cs, struct timer *timer)
+{
+	if(!timer->entry.next)
+		return -EINVAL;
+
+	list_del(&timer->entry);
+	cs->wheel->pending--;
+	return -EOK;
+}
+
+/**
+ * @brief Cascade the timers of the next level(s) down.
+ * @param wheel Wheel to cascade.
+ *
+ * Called every time level 0 wraps around. When a level wraps around as
+ * well, the next level is cascaded too.
+ */
+static void timer_wheel_cascade(struct timer_wheel *wheel)
+{
+	struct list_head *slot, *carriage, *x;
+	struct list_head tmp;
+	struct timer *timer;
+	unsigned long idx;
+	int level;
+
+	for(level = 1; level < CONFIG_TIMER_WHEEL_LEVELS; level++) {
+		idx = timer_wheel_index(wheel->clk, level);
+		slot = &wheel->vec[level][idx];
+
+		if(!list_empty(slot)) {
+			/* Detach the slot before re-inserting its timers */
+			tmp.next = slot->next;
+			tmp.prev = slot->prev;
+			tmp.next->prev = &tmp;
+			tmp.prev->next = &tmp;
+			list_head_init(slot);
+
+			list_for_each_safe(carriage, x, &tmp) {
+				timer = list_entry(carriage, struct timer, entry);
+				__timer_wheel_insert(wheel, timer);
+			}
+		}
+
+		if(idx)
+			break;
+	}
+}
+
+/**
+ * @brief Get the next expired timer from the timer wheel.
+ * @param cs Clocksource to get an expired timer from.
+ * @param now Current tick of \p cs.
+ * @return The next expired timer, which has been removed from the wheel.
+ * @retval NULL if no more timers have expired.
+ * @note No locks are aquired.
+ *
+ * The wheel clock is advanced up to \p now. When no timers are pending, the
+ * wheel clock is moved forward to \p now without walking the wheel.
+ */
+struct timer *raw_timer_wheel_next_expired(struct clocksource *cs, tick_t now)
+{
+	struct timer_wheel *wheel = cs->wheel;
+	struct list_head *slot;
+	struct timer *timer;
+
+	if(!wheel)
+		return NULL;
+
+	while(time_at_or_after(now, wheel->clk)) {
+		if(!wheel->pending) {
+			wheel->clk = now + 1;
+			break;
+		}
+
+		slot = &wheel->vec[0][timer_wheel_index(wheel->clk, 0)];
+		if(!list_empty(slot)) {
+			timer = list_entry(slot->next, struct timer, entry);
+			list_del(&timer->entry);
+			wheel->pending--;
+			return timer;
+		}
+
+		wheel->clk++;
+		if(!timer_wheel_index(wheel->clk, 0))
+			timer_wheel_cascade(wheel);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Get the earliest time stamp at which a timer on the wheel expires.
+ * @param cs Clocksource to check.
+ * @return The earliest expiry time stamp or NEVER if the wheel is empty.
+ * @note No locks are aquired.
+ *
+ * When level 0 is empty the next cascade point is returned. Timers can't
+ * expire before that point, so the result is a safe lower bound.
+ */
+time_t raw_timer_wheel_next_expiry(struct clocksource *cs)
+{
+	struct timer_wheel *wheel = cs->wheel;
+	unsigned long idx, offset;
+
+	if(!wheel || !wheel->pending)
+		return NEVER;
+
+	idx = timer_wheel_index(wheel->clk, 0);
+	for(offset = 0; idx + offset < TIMER_WHEEL_SIZE; offset++) {
+		if(!list_empty(&wheel->vec[0][idx + offset]))
+			return wheel->clk + offset;
+	}
+
+	return wheel->clk + offset;
+}
+
+/** @} */
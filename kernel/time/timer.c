@@ -29,6 +29,7 @@
 #include <etaos/error.h>
 #include <etaos/timer.h>
 #include <etaos/mem.h>
+#include <etaos/mempool.h>
 #include <etaos/bitops.h>
 #include <etaos/spinlock.h>
 #include <etaos/atomic.h>
@@ -43,6 +44,7 @@ static inline bool timer_is_expired(struct timer *timer)
 	return time_at_or_after(now, timer->expire_at);
 }
 
+#ifndef CONFIG_TIMER_WHEEL
 static int timer_list_comparator(struct list_head *lh1, struct list_head *lh2)
 {
 	struct timer *t1, *t2;
@@ -57,31 +59,235 @@ static int timer_list_comparator(struct list_head *lh1, struct list_head *lh2)
 
 	return 0;
 }
+#endif
 
-struct timer *timer_create(struct clocksource *cs, unsigned long ms,
-		void (*handle)(struct timer*,void*), void *arg,
-		unsigned long flags)
+#ifdef CONFIG_TIMER_WHEEL
+/**
+ * @brief Insert a timer into the timer wheel of its clocksource.
+ * @param cs Clocksource to insert into.
+ * @param timer Timer to insert.
+ */
+static void timer_insert(struct clocksource *cs, struct timer *timer)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+	raw_timer_wheel_insert(cs, timer);
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+}
+
+static inline int raw_timer_remove(struct timer *timer)
+{
+	return raw_timer_wheel_remove(timer->source, timer);
+}
+
+/**
+ * @brief Remove a timer from the timer wheel of its clocksource.
+ * @param timer Timer to remove.
+ * @return An error code.
+ */
+static int timer_remove(struct timer *timer)
+{
+	int rc;
+	unsigned long flags;
+	struct clocksource *cs = timer->source;
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+	rc = raw_timer_wheel_remove(cs, timer);
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+
+	return rc;
+}
+#else
+static inline void timer_insert(struct clocksource *cs, struct timer *timer)
+{
+	clocksource_insert_timer(cs, &timer->entry, &timer_list_comparator);
+}
+
+static inline int raw_timer_remove(struct timer *timer)
+{
+	if(!timer_is_armed(timer))
+		return -EINVAL;
+
+	return raw_clocksource_remove_timer(&timer->entry);
+}
+
+static inline int timer_remove(struct timer *timer)
 {
+	int rc;
+	unsigned long flags;
+	struct clocksource *cs = timer->source;
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+	rc = raw_timer_remove(timer);
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+
+	return rc;
+}
+#endif
+
+#ifdef CONFIG_TIMER_POOL
+DEFINE_MEM_POOL(timer_pool, sizeof(struct timer), CONFIG_TIMER_POOL_SIZE);
+#endif
+
+/**
+ * @brief Allocate a zero initialised timer.
+ * @return The allocated timer or \p NULL.
+ *
+ * Timers are taken from the timer pool if possible. The heap is used
+ * when the pool is exhausted.
+ */
+static struct timer *timer_alloc(void)
+{
+#ifdef CONFIG_TIMER_POOL
 	struct timer *timer;
-	time_t expire;
 
+	timer = mem_pool_zalloc(&timer_pool);
+	if(timer)
+		return timer;
+#endif
 
-	if((timer = kzalloc(sizeof(*timer))) == NULL)
-		return NULL;
+	return kzalloc(sizeof(struct timer));
+}
+
+/**
+ * @brief Free a timer that has been removed from its clocksource.
+ * @param timer Timer to release.
+ *
+ * Statically allocated timers are left alone, they can be armed again.
+ */
+static inline void timer_release(struct timer *timer)
+{
+	if(test_bit(TIMER_STATIC_FLAG, &timer->flags))
+		return;
+
+#ifdef CONFIG_TIMER_POOL
+	if(mem_pool_free(&timer_pool, timer) == -EOK)
+		return;
+#endif
+
+	kfree(timer);
+}
+
+/**
+ * @brief Set the expiry time and interval of a timer.
+ * @param timer Timer to set the expiry time of.
+ * @param ms Time to expiry in miliseconds.
+ */
+static void timer_set_expiry(struct timer *timer, unsigned long ms)
+{
+	struct clocksource *cs = timer->source;
+	time_t expire;
 
 	timer->interval = expire = (cs->freq / 1000UL) * ms;
 	expire += clocksource_get_tick(cs);
 
-	if(test_bit(TIMER_ONESHOT_FLAG, &flags))
+	if(test_bit(TIMER_ONESHOT_FLAG, &timer->flags))
 		timer->interval = 0;
 
-	list_head_init(&timer->entry);
 	timer->expire_at = expire;
+}
+
+/**
+ * @brief Initialise a statically allocated timer.
+ * @param timer Timer to initialise.
+ * @param cs Clocksource to run the timer on.
+ * @param handle Timer handler.
+ * @param arg Argument to \p handle.
+ * @param flags Timer flags.
+ * @note Don't initialise a timer that is armed.
+ * @see timer_arm timer_disarm
+ *
+ * A static timer is never allocated or freed by the timer core. It can be
+ * embedded in other data structures and armed and disarmed repeatedly.
+ */
+void timer_init_static(struct timer *timer, struct clocksource *cs,
+		void (*handle)(struct timer*,void*), void *arg,
+		unsigned long flags)
+{
+	timer->entry.next = timer->entry.prev = NULL;
 	timer->source = cs;
 	timer->handle = handle;
 	timer->priv_data = arg;
+	timer->expire_at = 0;
+	timer->interval = 0;
+	timer->flags = flags;
+	set_bit(TIMER_STATIC_FLAG, &timer->flags);
+}
 
-	clocksource_insert_timer(cs, &timer->entry, &timer_list_comparator);
+/**
+ * @brief Arm a static timer.
+ * @param timer Timer to arm.
+ * @param ms Time to expiry in miliseconds.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -ENOTINITIALISED if the timer wheel of the clocksource of
+ *                          \p timer couldn't be allocated.
+ *
+ * If \p timer is already armed, it will be re-armed with the new expiry
+ * time.
+ */
+int timer_arm(struct timer *timer, unsigned long ms)
+{
+	struct clocksource *cs = timer->source;
+	unsigned long flags;
+
+#ifdef CONFIG_TIMER_WHEEL
+	if(unlikely(!cs->wheel))
+		return -ENOTINITIALISED;
+#endif
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+	if(timer_is_armed(timer))
+		raw_timer_remove(timer);
+
+	timer_set_expiry(timer, ms);
+#ifdef CONFIG_TIMER_WHEEL
+	raw_timer_wheel_insert(cs, timer);
+#else
+	raw_clocksource_insert_timer(cs, &timer->entry, &timer_list_comparator);
+#endif
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+
+	return -EOK;
+}
+
+/**
+ * @brief Disarm a static timer.
+ * @param timer Timer to disarm.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p timer wasn't armed.
+ */
+int timer_disarm(struct timer *timer)
+{
+	return timer_remove(timer);
+}
+
+struct timer *timer_create(struct clocksource *cs, unsigned long ms,
+		void (*handle)(struct timer*,void*), void *arg,
+		unsigned long flags)
+{
+	struct timer *timer;
+
+#ifdef CONFIG_TIMER_WHEEL
+	if(unlikely(!cs->wheel))
+		return NULL;
+#endif
+
+	if((timer = timer_alloc()) == NULL)
+		return NULL;
+
+	clear_bit(TIMER_STATIC_FLAG, &flags);
+	timer->flags = flags;
+	timer->source = cs;
+	timer_set_expiry(timer, ms);
+
+	list_head_init(&timer->entry);
+	timer->handle = handle;
+	timer->priv_data = arg;
+
+	timer_insert(cs, timer);
 	return timer;
 }
 
@@ -89,9 +295,9 @@ int raw_timer_stop(struct timer *timer)
 {
 	int rc;
 
-	rc = raw_clocksource_remove_timer(&timer->entry);
+	rc = raw_timer_remove(timer);
 	if(rc == -EOK)
-		kfree(timer);
+		timer_release(timer);
 
 	return rc;
 }
@@ -100,13 +306,70 @@ int timer_stop(struct timer *timer)
 {
 	int rc;
 
-	rc = clocksource_remove_timer(timer->source, &timer->entry);
+	rc = timer_remove(timer);
 	if(rc == -EOK)
-		kfree(timer);
+		timer_release(timer);
 
 	return rc;
 }
 
+/**
+ * @brief Get the time stamp of the first timer to expire.
+ * @param cs Clocksource to check.
+ * @return The expiry time stamp of the first timer on \p cs.
+ * @retval NEVER if no timers are running on \p cs.
+ */
+time_t timer_next_expiry(struct clocksource *cs)
+{
+	unsigned long flags;
+	time_t next;
+#ifndef CONFIG_TIMER_WHEEL
+	struct timer *timer;
+#endif
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+#ifdef CONFIG_TIMER_WHEEL
+	next = raw_timer_wheel_next_expiry(cs);
+#else
+	if(list_empty(&cs->timers)) {
+		next = NEVER;
+	} else {
+		timer = list_entry(cs->timers.next, struct timer, entry);
+		next = timer->expire_at;
+	}
+#endif
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+
+	return next;
+}
+
+#ifdef CONFIG_TIMER_WHEEL
+void timer_process(struct clocksource *cs)
+{
+	unsigned long flags;
+	struct timer *timer;
+	tick_t now;
+
+	raw_spin_lock_irqsave(&cs->lock, flags);
+	clocksource_update(cs);
+	now = clocksource_get_tick(cs);
+
+	while((timer = raw_timer_wheel_next_expired(cs, now)) != NULL) {
+		if(timer->handle)
+			timer->handle(timer, timer->priv_data);
+
+		if(timer->interval) {
+			timer->expire_at = timer->interval +
+				clocksource_get_tick(cs);
+			raw_timer_wheel_insert(cs, timer);
+		} else {
+			timer_release(timer);
+		}
+	}
+
+	raw_spin_unlock_irqrestore(&cs->lock, flags);
+}
+#else
 void timer_process(struct clocksource *cs)
 {
 	unsigned long flags;
@@ -130,7 +393,7 @@ void timer_process(struct clocksource *cs)
 				raw_clocksource_insert_timer(cs, &timer->entry,
 						&timer_list_comparator);
 			} else {
-				kfree(timer);
+				timer_release(timer);
 			}
 
 		} else {
@@ -140,5 +403,6 @@ void timer_process(struct clocksource *cs)
 
 	raw_spin_unlock_irqrestore(&cs->lock, flags);
 }
+#endif
 
 /** @} */
@@ -31,7 +31,11 @@
  */
 void *kmalloc(size_t size)
 {
+#ifdef CONFIG_MM_TRACE
+	return __mm_alloc(size, __builtin_return_address(0));
+#else
 	return mm_alloc(size);
+#endif
 }
 
 /** @} */
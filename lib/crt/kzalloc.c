@@ -37,7 +37,11 @@ void *kzalloc(size_t size)
 {
 	void *data;
 
+#ifdef CONFIG_MM_TRACE
+	data = __mm_alloc(size, __builtin_return_address(0));
+#else
 	data = mm_alloc(size);
+#endif
 	if(data)
 		memset(data, 0, size);
 
@@ -49,7 +53,11 @@ void *kzalloc(size_t size)
 	void *data;
 	volatile unsigned char *ptr;
 
+#ifdef CONFIG_MM_TRACE
+	data = __mm_alloc(size, __builtin_return_address(0));
+#else
 	data = mm_alloc(size);
+#endif
 	if(data) {
 		ptr = data;
 		do {
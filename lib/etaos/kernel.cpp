@@ -95,5 +95,27 @@ time_t Kernel::time(void)
 	return rv;
 }
 
+#ifdef CONFIG_SCHED_STATS
+/**
+ * @brief Get the global scheduling statistics.
+ * @param stats Structure to copy the statistics into.
+ */
+void Kernel::stats(struct sched_stats *stats)
+{
+	sched_get_stats(stats);
+}
+
+/**
+ * @brief Get the scheduling statistics of a thread.
+ * @param tp Thread to get the statistics of.
+ * @param stats Structure to copy the statistics into.
+ * @return An error code.
+ */
+int Kernel::stats(struct thread *tp, struct thread_stats *stats)
+{
+	return sched_get_thread_stats(tp, stats);
+}
+#endif
+
 /** @} */
 
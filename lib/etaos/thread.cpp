@@ -26,6 +26,7 @@
 #include <etaos/error.h>
 #include <etaos/thread.h>
 #include <etaos/event.h>
+#include <etaos/string.h>
 
 #include <etaos/stl/kernel.h>
 #include <etaos/stl/thread.h>
@@ -48,6 +49,7 @@ Thread::Thread(const char *name, void *arg)
 {
 	thread_attr_t attrs;
 
+	memset(&attrs, 0, sizeof(attrs));
 	attrs.prio = SCHED_DEFAULT_PRIO;
 	attrs.stack = NULL;
 	attrs.stack_size = 0;
@@ -0,0 +1,219 @@
+/*
+ *  ETA/OS - Ring buffer
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup ringbuffer
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/ringbuffer.h>
+
+/**
+ * @brief Initialise a ring buffer.
+ * @param rb Ring buffer to initialise.
+ * @param buf Data buffer.
+ * @param size Size of \p buf.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p size is not a power of two or too large.
+ */
+int ring_buffer_init(struct ring_buffer *rb, void *buf, size_t size)
+{
+	if(!size || size > RING_BUFFER_MAX_SIZE || (size & (size - 1)))
+		return -EINVAL;
+
+	rb->buffer = buf;
+	rb->mask = (ring_index_t)(size - 1);
+	rb->head = 0;
+	rb->tail = 0;
+#ifdef CONFIG_EVENT_MUTEX
+	thread_queue_init(&rb->wq);
+#endif
+
+	return -EOK;
+}
+
+/**
+ * @brief Discard all data in a ring buffer.
+ * @param rb Ring buffer to reset.
+ * @note Neither the producer nor the consumer should be active.
+ */
+void ring_buffer_reset(struct ring_buffer *rb)
+{
+	rb->tail = rb->head;
+}
+
+/**
+ * @brief Write a byte into a ring buffer.
+ * @param rb Ring buffer to write to.
+ * @param c Byte to write.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EAGAIN if \p rb is full.
+ * @note Should only be called by the producer.
+ */
+int ring_buffer_put(struct ring_buffer *rb, uint8_t c)
+{
+	ring_index_t head, next;
+
+	head = rb->head;
+	next = (head + 1) & rb->mask;
+	if(next == rb->tail)
+		return -EAGAIN;
+
+	rb->buffer[head] = c;
+	barrier();
+	rb->head = next;
+
+	return -EOK;
+}
+
+/**
+ * @brief Read a byte from a ring buffer.
+ * @param rb Ring buffer to read from.
+ * @return The byte read or an error code.
+ * @retval -EAGAIN if \p rb is empty.
+ * @note Should only be called by the consumer.
+ */
+int ring_buffer_get(struct ring_buffer *rb)
+{
+	ring_index_t tail;
+	uint8_t c;
+
+	tail = rb->tail;
+	if(tail == rb->head)
+		return -EAGAIN;
+
+	c = rb->buffer[tail];
+	barrier();
+	rb->tail = (tail + 1) & rb->mask;
+
+	return c;
+}
+
+/**
+ * @brief Write a block of data into a ring buffer.
+ * @param rb Ring buffer to write to.
+ * @param buf Data to write.
+ * @param len Length of \p buf.
+ * @return The number of bytes written.
+ * @note Should only be called by the producer.
+ *
+ * The head index is only updated once, after all data has been copied.
+ */
+size_t ring_buffer_write(struct ring_buffer *rb, const void *buf, size_t len)
+{
+	const uint8_t *data = buf;
+	ring_index_t head, tail;
+	size_t num;
+
+	head = rb->head;
+	tail = rb->tail;
+
+	for(num = 0; num < len; num++) {
+		if(((head + 1) & rb->mask) == tail)
+			break;
+
+		rb->buffer[head] = data[num];
+		head = (head + 1) & rb->mask;
+	}
+
+	barrier();
+	rb->head = head;
+
+	return num;
+}
+
+/**
+ * @brief Read a block of data from a ring buffer.
+ * @param rb Ring buffer to read from.
+ * @param buf Buffer to store the data in.
+ * @param len Length of \p buf.
+ * @return The number of bytes read.
+ * @note Should only be called by the consumer.
+ *
+ * The tail index is only updated once, after all data has been copied.
+ */
+size_t ring_buffer_read(struct ring_buffer *rb, void *buf, size_t len)
+{
+	uint8_t *data = buf;
+	ring_index_t head, tail;
+	size_t num;
+
+	head = rb->head;
+	tail = rb->tail;
+
+	for(num = 0; num < len && tail != head; num++) {
+		data[num] = rb->buffer[tail];
+		tail = (tail + 1) & rb->mask;
+	}
+
+	barrier();
+	rb->tail = tail;
+
+	return num;
+}
+
+#ifdef CONFIG_EVENT_MUTEX
+/**
+ * @brief Write a byte into a ring buffer, wait if it is full.
+ * @param rb Ring buffer to write to.
+ * @param c Byte to write.
+ * @param ms Maximum time to wait for space (0 waits forever).
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EAGAIN if \p rb stayed full for \p ms miliseconds.
+ * @note The consumer should call ring_buffer_wake_irq or ring_buffer_wake
+ *       after it has read data.
+ */
+int ring_buffer_put_wait(struct ring_buffer *rb, uint8_t c, unsigned ms)
+{
+	while(ring_buffer_put(rb, c)) {
+		if(raw_event_wait(&rb->wq, ms))
+			return ring_buffer_put(rb, c);
+	}
+
+	return -EOK;
+}
+
+/**
+ * @brief Read a byte from a ring buffer, wait if it is empty.
+ * @param rb Ring buffer to read from.
+ * @param ms Maximum time to wait for data (0 waits forever).
+ * @return The byte read or an error code.
+ * @retval -EAGAIN if \p rb stayed empty for \p ms miliseconds.
+ * @note The producer should call ring_buffer_wake_irq or ring_buffer_wake
+ *       after it has written data.
+ */
+int ring_buffer_get_wait(struct ring_buffer *rb, unsigned ms)
+{
+	int c;
+
+	while((c = ring_buffer_get(rb)) < 0) {
+		if(raw_event_wait(&rb->wq, ms))
+			return ring_buffer_get(rb);
+	}
+
+	return c;
+}
+#endif
+
+/** @} */
@@ -62,6 +62,9 @@ void mm_init(void)
 static void *mm_prep_user_area(struct heap_node *node)
 {
     int *tp = (int *) (uintptr_t) &node->next;
+#ifdef CONFIG_MM_TRACE
+    node->site = NULL;
+#endif
 #ifdef CONFIG_MM_GUARD
     size_t off = (node->size - HEAP_OVERHEAD) / sizeof(int) - 2;
 
@@ -71,7 +74,7 @@ static void *mm_prep_user_area(struct heap_node *node)
     return tp;
 }
 
-static int mm_validate_user_area(struct heap_node *node)
+static inline int mm_validate_user_area(struct heap_node *node)
 {
 	return -EOK;
 }
@@ -155,6 +158,7 @@ void *raw_mm_heap_alloc(struct heap_node **root,
 	return fit;
 }
 
+#ifndef CONFIG_SYS_SF
 static void *raw_mm_heap_alloc_aligned(struct heap_node **root,
 		size_t size, size_t alignment)
 {
@@ -163,6 +167,7 @@ static void *raw_mm_heap_alloc_aligned(struct heap_node **root,
 	real_size = __MM_TOP_ALIGN__(size, alignment);
 	return raw_mm_heap_alloc(root, real_size, mm_node_compare_ptr);
 }
+#endif
 
 static inline struct heap_node *mm_region_to_node(void *ptr)
 {
@@ -170,6 +175,28 @@ static inline struct heap_node *mm_region_to_node(void *ptr)
 		((uintptr_t)ptr - (HEAP_OVERHEAD + MM_GUARD_BYTES));
 }
 
+#ifdef CONFIG_MM_TRACE
+/**
+ * @brief Account an allocation in the heap statistics.
+ * @param ptr Allocated region or \p NULL if the allocation failed.
+ * @param site Call site of the allocation.
+ * @note Should be called with the memory lock held.
+ */
+void raw_mm_heap_trace_alloc(void *ptr, const void *site)
+{
+	struct heap_node *node;
+
+	if(!ptr) {
+		raw_mm_trace_failure();
+		return;
+	}
+
+	node = mm_region_to_node(ptr);
+	node->site = site;
+	raw_mm_trace_alloc(site, node->size);
+}
+#endif
+
 /**
  * @brief Get the size of a memory region.
  * @param ptr Memory region to get the size of.
@@ -178,18 +205,25 @@ static inline struct heap_node *mm_region_to_node(void *ptr)
  */
 size_t mm_node_size(void *ptr)
 {
+#ifndef CONFIG_SYS_SF
 	struct heap_node *node;
+#endif
 	size_t size;
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	size = raw_mm_sf_node_size(ptr);
+#else
 	node = mm_region_to_node(ptr);
 	size = node->size;
+#endif
 	raw_spin_unlock_irqrestore(&mlock, flags);
 
 	return size;
 }
 
+#ifndef CONFIG_SYS_SF
 #ifdef CONFIG_MM_DEBUG
 static int raw_mm_heap_free(struct heap_node **root, void *block,
 		const char *file, int line)
@@ -197,9 +231,8 @@ static int raw_mm_heap_free(struct heap_node **root, void *block,
 static int raw_mm_heap_free(struct heap_node **root, void *block)
 #endif
 {
-	struct heap_node *node,
-			 **npp,
-			 *fnode;
+	struct heap_node *prev, *next, *fnode;
+	uintptr_t start;
 
 	if(!block)
 		return -EINVAL;
@@ -209,62 +242,50 @@ static int raw_mm_heap_free(struct heap_node **root, void *block)
 	if(mm_validate_user_area(fnode))
 		return -EINVAL;
 
-	node = *root;
-	npp = root;
-	while(node) {
-		if((uintptr_t)node + node->size == (uintptr_t)fnode) {
-			/* Node fits right in front */
-			node->size += fnode->size;
-
-			/* Check if another node is directly following,
-			 * if so, merge it aswell
-			 */
-			if(((uintptr_t)node + node->size) ==
-					(uintptr_t)node->next) {
-				node->size += node->next->size;
-				node->next = node->next->next;
-			}
-			break;
-		}
-
-		if((uintptr_t)node > (uintptr_t)fnode) {
-			/* We are past the walker address now */
-			*npp = fnode;
-			if(((uintptr_t)fnode + fnode->size) == (uintptr_t)node) {
-				fnode->size += node->size;
-				fnode->next = node->next;
-			} else {
-				fnode->next = node;
-			}
-
-			break;
-		}
-
-		/*
-		 * If we are within another node address, somebody probably
-		 * has tried to free up an invalid address, or free'd a
-		 * node twice.
-		 */
-		if(((uintptr_t)node + node->size) > (uintptr_t)fnode) {
+	/*
+	 * The free list is sorted by address. Find the free nodes directly
+	 * in front of and after the released node.
+	 */
+	start = (uintptr_t)fnode;
+	prev = NULL;
+	for(next = *root; next && (uintptr_t)next < start; next = next->next)
+		prev = next;
+
+	/*
+	 * If the node overlaps with one of its free neighbours, somebody
+	 * has tried to free up an invalid address, or free'd a node twice.
+	 */
+	if((prev && (uintptr_t)prev + prev->size > start) ||
+			(next && start + fnode->size > (uintptr_t)next)) {
 #ifdef CONFIG_MM_DEBUG
-			fprintf(stderr, "Trying to release free heap memory "
-					"[%p] from %s:%i\n",
-					block, file, line);
+		fprintf(stderr, "Trying to release free heap memory "
+				"[%p] from %s:%i\n",
+				block, file, line);
 #endif
-			return -EINVAL;
-		}
+		return -EINVAL;
+	}
 
-		npp = &node->next;
-		node = node->next;
+	/* Merge with the next node if it directly follows */
+	if(next && start + fnode->size == (uintptr_t)next) {
+		fnode->size += next->size;
+		fnode->next = next->next;
+	} else {
+		fnode->next = next;
 	}
 
-	if(!node) {
-		fnode->next = node;
-		*npp = fnode;
+	/* Merge into the previous node if it directly precedes */
+	if(prev && (uintptr_t)prev + prev->size == start) {
+		prev->size += fnode->size;
+		prev->next = fnode->next;
+	} else if(prev) {
+		prev->next = fnode;
+	} else {
+		*root = fnode;
 	}
 
 	return -EOK;
 }
+#endif
 
 /**
  * @brief Allocate a new memory region using a specific allocator.
@@ -274,30 +295,38 @@ static int raw_mm_heap_free(struct heap_node **root, void *block)
  */
 MEM void *mm_heap_alloc(size_t size, allocator_t allocator)
 {
+	const void *site;
 	void *rv = NULL;
 
+	site = mm_trace_site();
 	switch(allocator) {
 	case BEST_FIT:
 #ifdef CONFIG_BEST_FIT
-		rv = mm_best_fit_alloc(size);
+		rv = __mm_best_fit_alloc(size, site);
 #endif
 		break;
 
 	case FIRST_FIT:
 #ifdef CONFIG_FIRST_FIT
-		rv = mm_first_fit_alloc(size);
+		rv = __mm_first_fit_alloc(size, site);
 #endif
 		break;
 
 	case WORST_FIT:
 #ifdef CONFIG_WORST_FIT
-		rv = mm_worst_fit_alloc(size);
+		rv = __mm_worst_fit_alloc(size, site);
+#endif
+		break;
+
+	case SEGREGATED_FIT:
+#ifdef CONFIG_SEGREGATED_FIT
+		rv = mm_sf_alloc(size);
 #endif
 		break;
 
 	/* case SYSTEM_ALLOCATOR: */
 	default:
-		rv = mm_alloc(size);
+		rv = __mm_alloc(size, site);
 		break;
 	}
 
@@ -305,22 +334,42 @@ MEM void *mm_heap_alloc(size_t size, allocator_t allocator)
 }
 
 /**
- * @brief Allocate a new memory region.
+ * @brief Allocate a new memory region on behalf of a call site.
  * @param size Number of bytes to allocate.
+ * @param site Call site to account the allocation to.
  * @return The allocated memory region of size \p size or \p NULL.
+ * @note \p site is only used when allocation tracing is enabled.
  */
-MEM void *mm_alloc(size_t size)
+MEM void *__mm_alloc(size_t size, const void *site)
 {
 	unsigned long flags;
+	tick_t start;
 	void *rv;
 
+	start = mm_trace_start();
 	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	rv = raw_mm_sf_alloc(size);
+#else
 	rv = raw_mm_heap_alloc(&mm_free_list, size, mm_node_compare_ptr);
+	raw_mm_heap_trace_alloc(rv, site);
+#endif
 	raw_spin_unlock_irqrestore(&mlock, flags);
+	mm_trace_end(start);
 
 	return rv;
 }
 
+/**
+ * @brief Allocate a new memory region.
+ * @param size Number of bytes to allocate.
+ * @return The allocated memory region of size \p size or \p NULL.
+ */
+MEM void *mm_alloc(size_t size)
+{
+	return __mm_alloc(size, mm_trace_site());
+}
+
 /**
  * @brief Allocate an area of memory aligned to \p alignment.
  * @param size Minimum size of the region to allocate.
@@ -330,11 +379,19 @@ MEM void *mm_alloc(size_t size)
 MEM void *mm_alloc_aligned(size_t size, size_t alignment)
 {
 	unsigned long flags;
+	tick_t start;
 	void *rv;
 
+	start = mm_trace_start();
 	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	rv = raw_mm_sf_alloc(__MM_TOP_ALIGN__(size, alignment));
+#else
 	rv = raw_mm_heap_alloc_aligned(&mm_free_list, size, alignment);
+	raw_mm_heap_trace_alloc(rv, mm_trace_site());
+#endif
 	raw_spin_unlock_irqrestore(&mlock, flags);
+	mm_trace_end(start);
 
 	return rv;
 }
@@ -354,13 +411,37 @@ int mm_free(void *block)
 {
 	unsigned long flags;
 	int rv;
+#ifdef CONFIG_MM_TRACE
+	const void *site = NULL;
+	size_t size = 0;
+#endif
 
 	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_MM_TRACE
+	if(block) {
+		site = mm_region_to_node(block)->site;
+		size = mm_region_to_node(block)->size;
+	}
+#endif
+
+#if defined(CONFIG_SYS_SF)
+	rv = raw_mm_sf_free(block);
 #ifdef CONFIG_MM_DEBUG
+	if(rv && block)
+		fprintf(stderr, "Trying to release free heap memory "
+				"[%p] from %s:%i\n",
+				block, file, line);
+#endif
+#elif defined(CONFIG_MM_DEBUG)
 	rv = raw_mm_heap_free(&mm_free_list, block, file, line);
 #else
 	rv = raw_mm_heap_free(&mm_free_list, block);
 #endif
+
+#ifdef CONFIG_MM_TRACE
+	if(rv == -EOK && site)
+		raw_mm_trace_free(site, size);
+#endif
 	raw_spin_unlock_irqrestore(&mlock, flags);
 
 	return rv;
@@ -374,6 +455,9 @@ int mm_free(void *block)
  */
 void raw_mm_heap_add_block(void *addr, size_t size)
 {
+#ifdef CONFIG_SYS_SF
+	raw_mm_sf_add_block(addr, size);
+#else
 	struct heap_node *node = (struct heap_node*)MM_TOP_ALIGN((uintptr_t)addr);
 
 	node->size = MM_BOTTOM_ALIGN(size - ((uintptr_t)node - (uintptr_t)addr));
@@ -382,6 +466,7 @@ void raw_mm_heap_add_block(void *addr, size_t size)
 #else
 	raw_mm_heap_free(&mm_free_list, mm_prep_user_area(node));
 #endif
+#endif
 }
 
 /**
@@ -399,6 +484,7 @@ void mm_heap_add_block(void *addr, size_t size)
 	raw_spin_unlock_irqrestore(&mlock, flags);
 }
 
+#ifndef CONFIG_SYS_SF
 static size_t raw_mm_heap_available(struct heap_node **root)
 {
 	size_t rv = 0UL;
@@ -411,6 +497,20 @@ static size_t raw_mm_heap_available(struct heap_node **root)
 	return rv;
 }
 
+static size_t raw_mm_heap_largest_block(struct heap_node **root)
+{
+	size_t rv = 0UL;
+	struct heap_node *node;
+
+	for(node = *root; node; node = node->next) {
+		if(node->size - HEAP_OVERHEAD > rv)
+			rv = node->size - HEAP_OVERHEAD;
+	}
+
+	return rv;
+}
+#endif
+
 /**
  * @brief Get the total number of bytes available in the allocator.
  * @return The number of free bytes available in the allocator.
@@ -421,11 +521,64 @@ size_t mm_heap_available(void)
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	rv = raw_mm_sf_available();
+#else
 	rv = raw_mm_heap_available(&mm_free_list);
+#endif
 	raw_spin_unlock_irqrestore(&mlock, flags);
 
 	return rv;
 }
 
+/**
+ * @brief Get the size of the largest free block in the allocator.
+ * @return The largest number of bytes that can be allocated at once.
+ */
+size_t mm_heap_largest_block(void)
+{
+	size_t rv;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	rv = raw_mm_sf_largest_block();
+#else
+	rv = raw_mm_heap_largest_block(&mm_free_list);
+#endif
+	raw_spin_unlock_irqrestore(&mlock, flags);
+
+	return rv;
+}
+
+/**
+ * @brief Get the fragmentation ratio of the heap.
+ * @return The fragmentation ratio in percent.
+ *
+ * The fragmentation ratio is the part of the available memory that can't
+ * be allocated in a single allocation: <i>100 - 100 * largest / available</i>.
+ * A ratio of 0 means all available memory is in a single block.
+ */
+unsigned int mm_heap_fragmentation(void)
+{
+	size_t avail, largest;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&mlock, flags);
+#ifdef CONFIG_SYS_SF
+	avail = raw_mm_sf_available();
+	largest = raw_mm_sf_largest_block();
+#else
+	avail = raw_mm_heap_available(&mm_free_list);
+	largest = raw_mm_heap_largest_block(&mm_free_list);
+#endif
+	raw_spin_unlock_irqrestore(&mlock, flags);
+
+	if(!avail)
+		return 0;
+
+	return 100U - (unsigned int)(((unsigned long)largest * 100UL) / avail);
+}
+
 /** @} */
 
@@ -0,0 +1,158 @@
+/*
+ *  ETA/OS - Fixed size object pools
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup mempool
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/mem.h>
+#include <etaos/mempool.h>
+#include <etaos/spinlock.h>
+#include <etaos/string.h>
+
+/**
+ * @brief Initialise an object pool.
+ * @param pool Pool to initialise.
+ * @param storage Backing storage of the pool.
+ * @param obj_size Size of a single object.
+ * @param num Number of objects in the pool.
+ * @note \p storage should be at least
+ *       <i>MEM_POOL_OBJ_SIZE(obj_size) * num</i> bytes large.
+ */
+void mem_pool_init(struct mem_pool *pool, void *storage,
+		size_t obj_size, size_t num)
+{
+	pool->obj_size = MEM_POOL_OBJ_SIZE(obj_size);
+	pool->free = NULL;
+	pool->start = storage;
+	pool->next = storage;
+	pool->end = pool->start + pool->obj_size * num;
+	spinlock_init(&pool->lock);
+}
+
+/**
+ * @brief Allocate an object pool on the heap.
+ * @param obj_size Size of a single object.
+ * @param num Number of objects in the pool.
+ * @return The allocated pool or \p NULL.
+ *
+ * The pool and its objects are allocated using a single heap allocation.
+ */
+struct mem_pool *mem_pool_create(size_t obj_size, size_t num)
+{
+	struct mem_pool *pool;
+	size_t size;
+
+	size = MEM_POOL_OBJ_SIZE(obj_size) * num;
+	pool = kmalloc(sizeof(*pool) + size);
+	if(!pool)
+		return NULL;
+
+	mem_pool_init(pool, pool + 1, obj_size, num);
+	return pool;
+}
+
+/**
+ * @brief Allocate an object from a pool.
+ * @param pool Pool to allocate from.
+ * @return The allocated object or \p NULL if \p pool is exhausted.
+ * @note This function runs in constant time.
+ */
+void *mem_pool_alloc(struct mem_pool *pool)
+{
+	unsigned long flags;
+	void *obj;
+
+	raw_spin_lock_irqsave(&pool->lock, flags);
+	obj = pool->free;
+	if(obj) {
+		pool->free = *(void**)obj;
+	} else if(pool->next < pool->end) {
+		obj = pool->next;
+		pool->next += pool->obj_size;
+	}
+	raw_spin_unlock_irqrestore(&pool->lock, flags);
+
+	return obj;
+}
+
+/**
+ * @brief Allocate a zero initialised object from a pool.
+ * @param pool Pool to allocate from.
+ * @return The allocated object or \p NULL if \p pool is exhausted.
+ */
+void *mem_pool_zalloc(struct mem_pool *pool)
+{
+	void *obj;
+
+	obj = mem_pool_alloc(pool);
+	if(obj)
+		memset(obj, 0, pool->obj_size);
+
+	return obj;
+}
+
+/**
+ * @brief Return an object to its pool.
+ * @param pool Pool \p obj was allocated from.
+ * @param obj Object to release.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p obj is not part of \p pool.
+ * @note This function runs in constant time.
+ */
+int mem_pool_free(struct mem_pool *pool, void *obj)
+{
+	unsigned long flags;
+
+	if(!obj || !mem_pool_contains(pool, obj))
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&pool->lock, flags);
+	*(void**)obj = pool->free;
+	pool->free = obj;
+	raw_spin_unlock_irqrestore(&pool->lock, flags);
+
+	return -EOK;
+}
+
+/**
+ * @brief Get the number of free objects in a pool.
+ * @param pool Pool to check.
+ * @return The number of objects that can still be allocated from \p pool.
+ */
+size_t mem_pool_available(struct mem_pool *pool)
+{
+	unsigned long flags;
+	size_t num;
+	void *obj;
+
+	raw_spin_lock_irqsave(&pool->lock, flags);
+	num = (size_t)(pool->end - pool->next) / pool->obj_size;
+	for(obj = pool->free; obj; obj = *(void**)obj)
+		num++;
+	raw_spin_unlock_irqrestore(&pool->lock, flags);
+
+	return num;
+}
+
+/** @} */
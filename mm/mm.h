@@ -23,5 +23,43 @@
 #define MM_ACCEPT_NODE  1
 #define MM_REJECT_NODE  0
 
+#ifdef CONFIG_MM_TRACE
+extern void raw_mm_trace_alloc(const void *site, size_t size);
+extern void raw_mm_trace_failure(void);
+extern void raw_mm_trace_free(const void *site, size_t size);
+extern tick_t mm_trace_start(void);
+extern void mm_trace_end(tick_t start);
+extern void raw_mm_heap_trace_alloc(void *ptr, const void *site);
+
+#define mm_trace_site() __builtin_return_address(0)
+#else
+static inline void raw_mm_trace_alloc(const void *site, size_t size)
+{
+}
+
+static inline void raw_mm_trace_failure(void)
+{
+}
+
+static inline void raw_mm_trace_free(const void *site, size_t size)
+{
+}
+
+static inline tick_t mm_trace_start(void)
+{
+	return 0;
+}
+
+static inline void mm_trace_end(tick_t start)
+{
+}
+
+static inline void raw_mm_heap_trace_alloc(void *ptr, const void *site)
+{
+}
+
+#define mm_trace_site() NULL
+#endif
+
 #endif
 
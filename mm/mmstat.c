@@ -0,0 +1,266 @@
+/*
+ *  ETA/OS - Heap statistics
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup mm
+ * @{
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/mem.h>
+#include <etaos/spinlock.h>
+#include <etaos/string.h>
+#include <etaos/stdio.h>
+#include <etaos/init.h>
+
+#ifdef CONFIG_HRTIMER
+#include <etaos/hrtimer.h>
+#endif
+
+#ifdef CONFIG_DRIVER_CORE
+#include <etaos/device.h>
+#include <etaos/vfs.h>
+#endif
+
+#include "mm.h"
+
+static struct mm_stats mm_stats;
+
+/**
+ * @brief Get the statistics of a call site.
+ * @param site Call site to look up.
+ * @return The statistics entry of \p site or \p NULL if the table is full.
+ * @note Should be called with the memory lock held.
+ */
+static struct mm_site_stats *raw_mm_trace_site(const void *site)
+{
+	struct mm_site_stats *entry;
+	int idx;
+
+	for(idx = 0; idx < CONFIG_MM_TRACE_SITES; idx++) {
+		entry = &mm_stats.sites[idx];
+
+		if(entry->site == site)
+			return entry;
+
+		if(!entry->site) {
+			entry->site = site;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Account a successful allocation.
+ * @param site Call site of the allocation.
+ * @param size Number of heap bytes used by the allocation.
+ * @note Should be called with the memory lock held.
+ */
+void raw_mm_trace_alloc(const void *site, size_t size)
+{
+	struct mm_site_stats *entry;
+
+	mm_stats.allocs++;
+	mm_stats.in_use += size;
+	if(mm_stats.in_use > mm_stats.peak)
+		mm_stats.peak = mm_stats.in_use;
+
+	entry = raw_mm_trace_site(site);
+	if(!entry) {
+		mm_stats.untracked++;
+		return;
+	}
+
+	entry->allocs++;
+	entry->in_use += size;
+}
+
+/**
+ * @brief Account a failed allocation.
+ * @note Should be called with the memory lock held.
+ */
+void raw_mm_trace_failure(void)
+{
+	mm_stats.failures++;
+}
+
+/**
+ * @brief Account a release.
+ * @param site Call site of the original allocation.
+ * @param size Number of heap bytes released.
+ * @note Should be called with the memory lock held.
+ */
+void raw_mm_trace_free(const void *site, size_t size)
+{
+	struct mm_site_stats *entry;
+
+	mm_stats.frees++;
+	mm_stats.in_use -= size;
+
+	entry = raw_mm_trace_site(site);
+	if(!entry)
+		return;
+
+	entry->frees++;
+	entry->in_use -= size;
+}
+
+/**
+ * @brief Take a time stamp at the start of an allocation.
+ * @return The current cycle count of the high resolution clock.
+ * @see arch_hrtimer_cycles
+ */
+tick_t mm_trace_start(void)
+{
+#ifdef CONFIG_HRTIMER
+	if(hr_sys_clk)
+		return arch_hrtimer_cycles();
+#endif
+
+	return 0;
+}
+
+/**
+ * @brief Account the time spent in an allocation.
+ * @param start Time stamp taken by mm_trace_start.
+ *
+ * The time is measured in cycles of the high resolution clock, including the
+ * time spent waiting for the memory lock. The tick count of the clock source
+ * can't be used: it doesn't advance while the memory lock is held.
+ */
+void mm_trace_end(tick_t start)
+{
+	unsigned long flags;
+	unsigned long delta;
+
+	delta = (unsigned long)(mm_trace_start() - start);
+
+	raw_spin_lock_irqsave(&mlock, flags);
+	mm_stats.timed++;
+	mm_stats.total_time += delta;
+	if(delta > mm_stats.max_time)
+		mm_stats.max_time = delta;
+	raw_spin_unlock_irqrestore(&mlock, flags);
+}
+
+/**
+ * @brief Get a copy of the heap statistics.
+ * @param stats Structure to copy the statistics into.
+ */
+void mm_get_stats(struct mm_stats *stats)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&mlock, flags);
+	memcpy(stats, &mm_stats, sizeof(*stats));
+	raw_spin_unlock_irqrestore(&mlock, flags);
+}
+
+#ifdef CONFIG_DRIVER_CORE
+static int mmstat_open(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_lock(dev);
+	return -EOK;
+}
+
+static int mmstat_close(struct file *file)
+{
+	struct device *dev;
+
+	dev = container_of(file, struct device, file);
+	dev_unlock(dev);
+	return -EOK;
+}
+
+/**
+ * @brief Read the heap statistics.
+ * @param file Device file.
+ * @param buf Buffer to store the report in.
+ * @param len Length of \p buf.
+ * @return The number of bytes written into \p buf.
+ *
+ * The report is formatted as text, one <i>key value</i> pair per line. Call
+ * sites are reported by address, followed by the number of allocations,
+ * frees and bytes in use.
+ */
+static int mmstat_read(struct file *file, void *buf, size_t len)
+{
+	struct mm_stats stats;
+	struct mm_site_stats *site;
+	struct file out;
+	unsigned long avg;
+	int idx;
+
+	if(!len)
+		return 0;
+
+	mm_get_stats(&stats);
+	avg = stats.timed ? stats.total_time / stats.timed : 0;
+
+	memset(&out, 0, sizeof(out));
+	raw_vfs_init_buffered_file(&out, len - 1, buf);
+
+	fprintf(&out, "allocs %lu\nfrees %lu\nfailures %lu\n",
+			stats.allocs, stats.frees, stats.failures);
+	fprintf(&out, "in_use %u\npeak %u\n", (unsigned int)stats.in_use,
+			(unsigned int)stats.peak);
+	fprintf(&out, "available %u\nlargest %u\n",
+			(unsigned int)mm_heap_available(),
+			(unsigned int)mm_heap_largest_block());
+	fprintf(&out, "time_max %lu\ntime_avg %lu\n", stats.max_time, avg);
+	fprintf(&out, "untracked %lu\n", stats.untracked);
+
+	for(idx = 0; idx < CONFIG_MM_TRACE_SITES; idx++) {
+		site = &stats.sites[idx];
+		if(!site->site)
+			break;
+
+		fprintf(&out, "site %p %lu %lu %u\n", site->site, site->allocs,
+				site->frees, (unsigned int)site->in_use);
+	}
+
+	((char*)buf)[out.index] = '\0';
+	return (int)out.index;
+}
+
+static struct dev_file_ops mmstat_fops = {
+	.open = &mmstat_open,
+	.close = &mmstat_close,
+	.read = &mmstat_read,
+};
+
+static struct device mmstat_dev = {
+	.name = "mmstat",
+};
+
+static void __used mmstat_init(void)
+{
+	device_initialize(&mmstat_dev, &mmstat_fops);
+}
+
+device_init(mmstat_init);
+#endif
+
+/** @} */
@@ -0,0 +1,390 @@
+/*
+ *  ETA/OS - Segregated fit heap allocation
+ *  Copyright (C) 2017   Michel Megens <dev@bietje.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup sf
+ * @{
+ *
+ * Every block starts with a size word. The lower two bits of the size word
+ * are used as flags: SF_ALLOC_BIT marks the block as allocated and
+ * SF_PREV_FREE_BIT marks the block directly in front of it as free. Free
+ * blocks also store their size in their last word (the boundary tag), so
+ * the start of a free predecessor can be found in constant time.
+ *
+ * Free blocks are kept in one doubly linked list per power-of-two size
+ * class. A bitmap tracks which classes are non-empty.
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/mem.h>
+#include <etaos/bitops.h>
+#include <etaos/stdio.h>
+#include <etaos/panic.h>
+
+#include "mm.h"
+
+/**
+ * @brief Segregated fit block.
+ * @note The list pointers are only valid when the block is free.
+ */
+struct sf_block {
+	size_t size; //!< Block size and flags.
+	struct sf_block *next; //!< Next block in the size class.
+	struct sf_block *prev; //!< Previous block in the size class.
+};
+
+#define SF_ALLOC_BIT     ((size_t)1 << MM_ALLOC_FLAG)
+#define SF_PREV_FREE_BIT ((size_t)1 << 1)
+#define SF_FLAGS_MASK    (SF_ALLOC_BIT | SF_PREV_FREE_BIT)
+
+#define SF_ALIGNMENT (sizeof(void*) > 4 ? sizeof(void*) : 4)
+#define SF_ALIGN(s) (((s) + (SF_ALIGNMENT - 1)) & ~(SF_ALIGNMENT - 1))
+#define SF_BOTTOM_ALIGN(s) ((s) & ~(SF_ALIGNMENT - 1))
+
+#define SF_OVERHEAD  sizeof(size_t)
+#define SF_MIN_BLOCK (sizeof(struct sf_block) + sizeof(size_t))
+
+#define SF_BITS(__t) (sizeof(__t) * 8)
+#define SF_CLASSES \
+	(SF_BITS(size_t) < SF_BITS(unsigned long) ? \
+	 SF_BITS(size_t) : SF_BITS(unsigned long))
+
+static struct sf_block *sf_heads[SF_CLASSES];
+static unsigned long sf_bitmap;
+
+static inline size_t sf_size(struct sf_block *block)
+{
+	return block->size & ~SF_FLAGS_MASK;
+}
+
+static inline struct sf_block *sf_next_block(struct sf_block *block)
+{
+	return (struct sf_block*)((uintptr_t)block + sf_size(block));
+}
+
+static inline size_t *sf_footer(struct sf_block *block)
+{
+	return (size_t*)((uintptr_t)block + sf_size(block) - sizeof(size_t));
+}
+
+/**
+ * @brief Find the last set bit in a word.
+ * @param x Word to check, should not be 0.
+ * @return The (1 based) index of the most significant set bit.
+ */
+static inline int sf_fls(size_t x)
+{
+	return (int)SF_BITS(unsigned long) - __builtin_clzl((unsigned long)x);
+}
+
+/**
+ * @brief Get the size class of a block size.
+ * @param size Size to get the class for.
+ * @return The size class of \p size.
+ */
+static inline int sf_class(size_t size)
+{
+	int idx;
+
+	idx = sf_fls(size) - sf_fls(SF_MIN_BLOCK);
+	if(idx >= (int)SF_CLASSES)
+		idx = SF_CLASSES - 1;
+
+	return idx;
+}
+
+/**
+ * @brief Insert a free block into its size class.
+ * @param block Block to insert.
+ *
+ * The boundary tag of \p block is written and the block following \p block
+ * is marked as having a free predecessor.
+ */
+static void sf_insert(struct sf_block *block)
+{
+	int idx;
+
+	idx = sf_class(sf_size(block));
+	block->prev = NULL;
+	block->next = sf_heads[idx];
+	if(block->next)
+		block->next->prev = block;
+
+	sf_heads[idx] = block;
+	sf_bitmap |= 1UL << idx;
+
+	*sf_footer(block) = sf_size(block);
+	sf_next_block(block)->size |= SF_PREV_FREE_BIT;
+}
+
+/**
+ * @brief Remove a free block from its size class.
+ * @param block Block to remove.
+ */
+static void sf_remove(struct sf_block *block)
+{
+	int idx;
+
+	idx = sf_class(sf_size(block));
+	if(block->prev)
+		block->prev->next = block->next;
+	else
+		sf_heads[idx] = block->next;
+
+	if(block->next)
+		block->next->prev = block->prev;
+
+	if(!sf_heads[idx])
+		sf_bitmap &= ~(1UL << idx);
+}
+
+/**
+ * @brief Find a free block of at least \p need bytes.
+ * @param need Number of bytes needed, including overhead.
+ * @return A free block or \p NULL.
+ *
+ * Every block in a size class above the class of \p need is large enough
+ * for the allocation, so a fitting block is found using a single bitmap
+ * lookup. Only if all larger classes are empty, the size class of \p need
+ * itself is searched.
+ */
+static struct sf_block *sf_find(size_t need)
+{
+	struct sf_block *block;
+	unsigned long map;
+	int idx;
+
+	idx = sf_class(need);
+	block = sf_heads[idx];
+	if(block && sf_size(block) >= need)
+		return block;
+
+	if(idx + 1 < (int)SF_CLASSES) {
+		map = sf_bitmap & (~0UL << (idx + 1));
+		if(map)
+			return sf_heads[ffs_long(map) - 1];
+	}
+
+	for(; block; block = block->next) {
+		if(sf_size(block) >= need)
+			return block;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Allocate a new memory region.
+ * @param size Number of bytes to allocate.
+ * @return The allocated memory region of size \p size or \p NULL.
+ * @note No locks are aquired.
+ */
+void *raw_mm_sf_alloc(size_t size)
+{
+	struct sf_block *block, *rest;
+	size_t need, avail;
+
+	need = SF_ALIGN(size + SF_OVERHEAD);
+	if(need < size)
+		return NULL;
+
+	if(need < SF_MIN_BLOCK)
+		need = SF_MIN_BLOCK;
+
+	block = sf_find(need);
+	if(!block) {
+#ifdef CONFIG_MM_DESTRUCTIVE_ALLOC
+		panic("NO MEMORY!\n");
+#endif
+		return NULL;
+	}
+
+	sf_remove(block);
+	avail = sf_size(block);
+
+	if(avail - need >= SF_MIN_BLOCK) {
+		rest = (struct sf_block*)((uintptr_t)block + need);
+		rest->size = avail - need;
+		sf_insert(rest);
+		block->size = need | (block->size & SF_PREV_FREE_BIT);
+	} else {
+		sf_next_block(block)->size &= ~SF_PREV_FREE_BIT;
+	}
+
+	block->size |= SF_ALLOC_BIT;
+	return (void*)((uintptr_t)block + SF_OVERHEAD);
+}
+
+/**
+ * @brief Allocate a new memory region.
+ * @param size Number of bytes to allocate.
+ * @return The allocated memory region of size \p size or \p NULL.
+ */
+MEM void *mm_sf_alloc(size_t size)
+{
+	unsigned long flags;
+	void *rv;
+
+	raw_spin_lock_irqsave(&mlock, flags);
+	rv = raw_mm_sf_alloc(size);
+	raw_spin_unlock_irqrestore(&mlock, flags);
+
+	return rv;
+}
+
+/**
+ * @brief Free a previously allocated memory region.
+ * @param ptr Memory region to free.
+ * @return An error code.
+ * @retval -EOK on success.
+ * @retval -EINVAL if \p ptr is not an allocated region.
+ * @note No locks are aquired.
+ *
+ * The region is merged with its direct neighbours if they are free. Due to
+ * the boundary tags this runs in constant time.
+ */
+int raw_mm_sf_free(void *ptr)
+{
+	struct sf_block *block, *next, *prev;
+	size_t size;
+
+	if(!ptr)
+		return -EINVAL;
+
+	block = (struct sf_block*)((uintptr_t)ptr - SF_OVERHEAD);
+	if(!(block->size & SF_ALLOC_BIT))
+		return -EINVAL;
+
+	/*
+	 * Clear the flag, even if the header is merged away, to catch
+	 * double frees.
+	 */
+	block->size &= ~SF_ALLOC_BIT;
+	size = sf_size(block);
+	next = sf_next_block(block);
+	if(!(next->size & SF_ALLOC_BIT)) {
+		sf_remove(next);
+		size += sf_size(next);
+	}
+
+	if(block->size & SF_PREV_FREE_BIT) {
+		prev = (struct sf_block*)((uintptr_t)block -
+				*((size_t*)block - 1));
+		sf_remove(prev);
+		size += sf_size(prev);
+		block = prev;
+	}
+
+	block->size = size;
+	sf_insert(block);
+
+	return -EOK;
+}
+
+/**
+ * @brief Get the size of a memory region.
+ * @param ptr Memory region to get the size of.
+ * @return The size of the block backing \p ptr.
+ * @note No locks are aquired.
+ */
+size_t raw_mm_sf_node_size(void *ptr)
+{
+	return sf_size((struct sf_block*)((uintptr_t)ptr - SF_OVERHEAD));
+}
+
+/**
+ * @brief Add a new memory region to the allocator.
+ * @param addr Start of the memory region.
+ * @param size Size of the region pointed to by \p addr.
+ * @note No locks are aquired.
+ *
+ * The last word of the region is used as an allocated block of size 0, so
+ * blocks are never merged past the end of the region.
+ */
+void raw_mm_sf_add_block(void *addr, size_t size)
+{
+	struct sf_block *block, *end;
+	uintptr_t start;
+
+	start = SF_ALIGN((uintptr_t)addr);
+	if(size < (start - (uintptr_t)addr) + SF_MIN_BLOCK + SF_ALIGNMENT)
+		return;
+
+	size = SF_BOTTOM_ALIGN(size - (start - (uintptr_t)addr));
+	size -= SF_ALIGNMENT;
+
+	block = (struct sf_block*)start;
+	block->size = size;
+
+	end = sf_next_block(block);
+	end->size = SF_ALLOC_BIT;
+
+	sf_insert(block);
+}
+
+/**
+ * @brief Get the total number of bytes available in the allocator.
+ * @return The number of free bytes available in the allocator.
+ * @note No locks are aquired.
+ */
+size_t raw_mm_sf_available(void)
+{
+	struct sf_block *block;
+	size_t rv = 0;
+	int idx;
+
+	for(idx = 0; idx < (int)SF_CLASSES; idx++) {
+		for(block = sf_heads[idx]; block; block = block->next)
+			rv += sf_size(block) - SF_OVERHEAD;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Get the size of the largest free block.
+ * @return The largest number of bytes that can be allocated at once.
+ * @note No locks are aquired.
+ *
+ * Only the highest non-empty size class has to be searched.
+ */
+size_t raw_mm_sf_largest_block(void)
+{
+	struct sf_block *block;
+	size_t rv = 0;
+	int idx;
+
+	for(idx = SF_CLASSES - 1; idx >= 0; idx--) {
+		if(sf_bitmap & (1UL << idx))
+			break;
+	}
+
+	if(idx < 0)
+		return 0;
+
+	for(block = sf_heads[idx]; block; block = block->next) {
+		if(sf_size(block) - SF_OVERHEAD > rv)
+			rv = sf_size(block) - SF_OVERHEAD;
+	}
+
+	return rv;
+}
+
+/** @} */
@@ -46,21 +46,37 @@ int mm_worst_fit_compare(struct heap_node *prev, struct heap_node *current)
 }
 
 /**
- * @brief Allocate a new memory region.
+ * @brief Allocate a new memory region on behalf of a call site.
  * @param size Number of bytes to allocate.
+ * @param site Call site to account the allocation to.
  * @return The allocated memory region of size \p size or \p NULL.
+ * @note \p site is only used when allocation tracing is enabled.
  */
-MEM void *mm_worst_fit_alloc(size_t size)
+MEM void *__mm_worst_fit_alloc(size_t size, const void *site)
 {
 	unsigned long flags;
+	tick_t start;
 	void *rv;
 
+	start = mm_trace_start();
 	raw_spin_lock_irqsave(&mlock, flags);
 	rv = raw_mm_heap_alloc(&mm_free_list, size, &mm_worst_fit_compare);
+	raw_mm_heap_trace_alloc(rv, site);
 	raw_spin_unlock_irqrestore(&mlock, flags);
+	mm_trace_end(start);
 
 	return rv;
 }
 
+/**
+ * @brief Allocate a new memory region.
+ * @param size Number of bytes to allocate.
+ * @return The allocated memory region of size \p size or \p NULL.
+ */
+MEM void *mm_worst_fit_alloc(size_t size)
+{
+	return __mm_worst_fit_alloc(size, mm_trace_site());
+}
+
 /** @} */
 
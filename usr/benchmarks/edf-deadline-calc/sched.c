@@ -10,6 +10,9 @@
 #include <etaos/mem.h>
 #include <etaos/time.h>
 #include <etaos/tick.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/delay.h>
 
 #include <asm/pgm.h>
 
@@ -238,6 +241,89 @@ void __used test_calc_speed(void)
 	}
 }
 
+#define EDF_TEST_DURATION 5000
+
+/**
+ * @brief Periodic test task.
+ */
+struct edf_task {
+	const char *name;
+	unsigned long period;
+	unsigned long deadline;
+	unsigned long wcet;
+	unsigned int work; /* busy time per period in miliseconds */
+	unsigned long jobs;
+	unsigned long misses;
+	struct thread *tp;
+};
+
+/* Total utilisation: 2/10 + 6/25 + 15/50 = 0.74 */
+static struct edf_task edf_tasks[] = {
+	{ "edf-10", 10, 10, 3, 2, 0, 0, NULL },
+	{ "edf-25", 25, 20, 8, 6, 0, 0, NULL },
+	{ "edf-50", 50, 50, 20, 15, 0, 0, NULL },
+};
+
+#define EDF_NUM_TASKS (sizeof(edf_tasks) / sizeof(edf_tasks[0]))
+
+static volatile bool edf_test_done;
+
+THREAD(edf_task_handle, arg)
+{
+	struct edf_task *task = arg;
+
+	while(!edf_test_done) {
+		delay(task->work);
+		task->jobs++;
+		edf_wait_period();
+	}
+
+	kill();
+}
+
+static void test_deadline_misses(void)
+{
+	thread_attr_t attr;
+	struct edf_task *task;
+	unsigned int idx;
+
+	edf_test_done = false;
+	for(idx = 0; idx < EDF_NUM_TASKS; idx++) {
+		task = &edf_tasks[idx];
+
+		attr.stack = NULL;
+		attr.stack_size = CONFIG_STACK_SIZE;
+		attr.prio = SCHED_DEFAULT_PRIO;
+		attr.period = task->period;
+		attr.deadline = task->deadline;
+		attr.wcet = task->wcet;
+
+		task->tp = thread_create(task->name, &edf_task_handle, task,
+				&attr);
+		if(!task->tp) {
+			printf_P(PSTR("Failed to create %s, test aborted\n"),
+					task->name);
+			/* Let the tasks that were created exit */
+			edf_test_done = true;
+			return;
+		}
+	}
+
+	sleep(EDF_TEST_DURATION);
+
+	/* Sample the counters before the tasks exit */
+	for(idx = 0; idx < EDF_NUM_TASKS; idx++)
+		edf_tasks[idx].misses = edf_deadline_misses(edf_tasks[idx].tp);
+	edf_test_done = true;
+
+	printf_P(PSTR("\nDeadline misses (%ums):\n\n"), EDF_TEST_DURATION);
+	for(idx = 0; idx < EDF_NUM_TASKS; idx++) {
+		task = &edf_tasks[idx];
+		printf("%s: %lu jobs, %lu misses\n", task->name, task->jobs,
+				task->misses);
+	}
+}
+
 int main(void)
 {
 	int64_t tick_orig, tick_end, tick_between1, tick_between2;
@@ -262,6 +348,8 @@ int main(void)
 	       "Program memory test duration: %ims\n"
 	       "Data memory test duration: %ims\n",
 	       test1_duration, test2_duration, test3_duration);
+
+	test_deadline_misses();
 	return -EOK;
 }
 
@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Run the scheduler benchmarks for every scheduler class under simulavr.
+#
+# Usage: run-bench.sh [baseline.csv]
+#
+# The results of all runs are written to results.csv. If a baseline file
+# (a previous results.csv) is given, the run fails when the average of any
+# benchmark is more than BENCH_TOLERANCE percent above the baseline.
+#
+# Author: Michel Megens
+#
+
+ETAOS=${ETAOS:-$(pwd)/../../..}
+SIMULAVR=${SIMULAVR:-/usr/bin/simulavr}
+BENCH_TOLERANCE=${BENCH_TOLERANCE:-10}
+SCHEDULERS="rr fifo edf lottery"
+
+BENCH_DIR=$(pwd)
+RESULTS=$BENCH_DIR/results.csv
+BASELINE=$1
+
+MAKE="make -C $ETAOS ARCH=avr CROSS_COMPILE=avr-"
+
+echo "# bench,sched,test,samples,min,max,avg" > $RESULTS
+
+for sched in $SCHEDULERS; do
+	echo "Building the $sched benchmark.."
+	cat $BENCH_DIR/config-atmega328p.conf $BENCH_DIR/sched-$sched.conf \
+		> $ETAOS/.config
+
+	(yes "" | $MAKE oldconfig > /dev/null) || exit 1
+	$MAKE clean all modules_install INSTALL_MOD_PATH=$ETAOS/usr/lib \
+		> /dev/null || exit 1
+	$MAKE A=$BENCH_DIR app > /dev/null || exit 1
+
+	$SIMULAVR -d atmega328 -f $BENCH_DIR/test-app.img -W 0x20,- \
+		-R 0x21,- -e 0x22 -F 16000000 | tr -d '\r' | \
+		grep '^bench,' | tee -a $RESULTS
+done
+
+if [ -z "$BASELINE" ]; then
+	exit 0
+fi
+
+awk -F, -v tol=$BENCH_TOLERANCE '
+	/^#/ { next }
+	FNR == NR { base[$2 "," $3] = $7; next }
+	($2 "," $3) in base {
+		limit = base[$2 "," $3] * (100 + tol) / 100;
+		if($7 > limit) {
+			printf("Regression: %s %s avg %d > %d\n", $2, $3, $7, base[$2 "," $3]);
+			fail = 1;
+		}
+	}
+	END { exit fail }
+' $BASELINE $RESULTS
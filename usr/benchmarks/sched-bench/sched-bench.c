@@ -0,0 +1,353 @@
+/*
+ * ETA/OS scheduler latency benchmarks.
+ *
+ * Author: Michel Megens
+ * Date: 12 - 03 - 2017
+ *
+ * Measures context switch and wake up latencies in CPU cycles. The results
+ * are printed in CSV format, one line per benchmark:
+ *
+ *   bench,<scheduler>,<test>,<samples>,<min>,<max>,<avg>
+ */
+
+#include <etaos/kernel.h>
+#include <etaos/types.h>
+#include <etaos/error.h>
+#include <etaos/bitops.h>
+#include <etaos/irq.h>
+#include <etaos/thread.h>
+#include <etaos/sched.h>
+#include <etaos/event.h>
+#include <etaos/mutex.h>
+#include <etaos/hrtimer.h>
+#include <etaos/stdio.h>
+
+#include <asm/io.h>
+#include <asm/irq.h>
+#include <asm/pgm.h>
+
+#ifdef CONFIG_SIMUL_AVR
+#include <asm/simulavr.h>
+#endif
+
+#define BENCH_SAMPLES 32
+
+/*
+ * Timer2 drives the HR clock. It runs in fast PWM mode with OCR2A as TOP
+ * and a prescaler of 32, so the counter increments every 32 cycles.
+ */
+#define BENCH_PRESCALER 32UL
+#define BENCH_TICK_CYCLES ((OCR2A + 1UL) * BENCH_PRESCALER)
+
+#define BENCH_IRQ_PIN 2 /* INT0 is on PD2 */
+
+#if defined(CONFIG_SYS_EDF)
+#define BENCH_SCHED "edf"
+#elif defined(CONFIG_SYS_LOTTERY)
+#define BENCH_SCHED "lottery"
+#elif defined(CONFIG_SYS_FIFO)
+#define BENCH_SCHED "fifo"
+#else
+#define BENCH_SCHED "rr"
+#endif
+
+struct bench_result {
+	unsigned long min;
+	unsigned long max;
+	unsigned long total;
+	unsigned char samples;
+};
+
+static volatile unsigned long bench_stamp;
+static volatile bool bench_armed;
+static volatile bool bench_done;
+static struct bench_result *bench_res;
+
+static DEFINE_THREAD_QUEUE(bench_q);
+static DEFINE_MUTEX(bench_mutex);
+
+/*
+ * Get the number of CPU cycles since the HR clock started. The resolution
+ * is BENCH_PRESCALER cycles.
+ */
+static unsigned long bench_cycles(void)
+{
+	unsigned long flags, ticks;
+	unsigned char cnt;
+
+	irq_save_and_disable(&flags);
+	ticks = (unsigned long)hr_sys_clk->count;
+	cnt = TCNT2;
+
+	/* The counter might have wrapped before the overflow was handled */
+	if(TIFR2 & BIT(TOV2)) {
+		cnt = TCNT2;
+		ticks++;
+	}
+	irq_restore(&flags);
+
+	return ticks * BENCH_TICK_CYCLES + cnt * BENCH_PRESCALER;
+}
+
+static void bench_start(struct bench_result *res)
+{
+	res->min = ~0UL;
+	res->max = 0UL;
+	res->total = 0UL;
+	res->samples = 0;
+
+	bench_armed = false;
+	bench_done = false;
+	bench_res = res;
+}
+
+static inline void bench_arm(void)
+{
+	bench_stamp = bench_cycles();
+	bench_armed = true;
+}
+
+/*
+ * Record the cycles passed since the last call to bench_arm. Nothing is
+ * recorded if the benchmark isn't armed.
+ */
+static void bench_record(void)
+{
+	struct bench_result *res = bench_res;
+	unsigned long diff;
+
+	if(!bench_armed)
+		return;
+
+	diff = bench_cycles() - bench_stamp;
+	bench_armed = false;
+
+	if(diff < res->min)
+		res->min = diff;
+	if(diff > res->max)
+		res->max = diff;
+
+	res->total += diff;
+	res->samples++;
+}
+
+static void bench_wait_record(void)
+{
+	while(bench_armed)
+		yield();
+}
+
+static void bench_report(const char *test, struct bench_result *res)
+{
+	unsigned long avg;
+
+	avg = res->samples ? res->total / res->samples : 0UL;
+	printf_P(PSTR("bench,%s,%s,%u,%lu,%lu,%lu\n"), BENCH_SCHED, test,
+			res->samples, res->samples ? res->min : 0UL,
+			res->max, avg);
+}
+
+/*
+ * Yield: time from yield() in one thread to the other thread running.
+ */
+THREAD(yield_peer, arg)
+{
+	while(!bench_done) {
+		bench_record();
+		yield();
+	}
+
+	kill();
+}
+
+static void bench_yield(struct bench_result *res)
+{
+	int i;
+
+	bench_start(res);
+	thread_create("yield-peer", &yield_peer, NULL, NULL);
+
+	for(i = 0; i < BENCH_SAMPLES; i++) {
+		bench_arm();
+		yield();
+		bench_wait_record();
+	}
+
+	bench_done = true;
+	yield();
+}
+
+/*
+ * Event: time from event_notify() to the waiting thread running. The same
+ * peer is used for the timer benchmark.
+ */
+THREAD(event_peer, arg)
+{
+	while(!bench_done) {
+		raw_event_wait(&bench_q, EVENT_WAIT_INFINITE);
+		bench_record();
+	}
+
+	kill();
+}
+
+static void bench_event_finish(void)
+{
+	bench_done = true;
+	event_notify(&bench_q);
+	yield();
+}
+
+static void bench_event(struct bench_result *res)
+{
+	int i;
+
+	bench_start(res);
+	thread_create("event-peer", &event_peer, NULL, NULL);
+
+	for(i = 0; i < BENCH_SAMPLES; i++) {
+		yield();
+		bench_arm();
+		event_notify(&bench_q);
+		bench_wait_record();
+	}
+
+	bench_event_finish();
+}
+
+/*
+ * Mutex: time from mutex_unlock() to the blocked thread owning the mutex.
+ */
+THREAD(mutex_peer, arg)
+{
+	while(!bench_done) {
+		mutex_lock(&bench_mutex);
+		bench_record();
+		mutex_unlock(&bench_mutex);
+		yield();
+	}
+
+	kill();
+}
+
+static inline bool bench_mutex_contended(void)
+{
+	struct thread *tp = bench_mutex.qp.qhead;
+
+	return tp && tp != SIGNALED;
+}
+
+static void bench_mutex_pingpong(struct bench_result *res)
+{
+	int i;
+
+	bench_start(res);
+	thread_create("mutex-peer", &mutex_peer, NULL, NULL);
+
+	for(i = 0; i <= BENCH_SAMPLES; i++) {
+		mutex_lock(&bench_mutex);
+		while(!bench_mutex_contended())
+			yield();
+
+		if(i == BENCH_SAMPLES)
+			bench_done = true;
+		else
+			bench_arm();
+
+		mutex_unlock(&bench_mutex);
+		bench_wait_record();
+	}
+
+	yield();
+}
+
+/*
+ * Timer: time from an HR timer expiring to the notified thread running.
+ */
+static void bench_timer_handle(struct hrtimer *timer, void *arg)
+{
+	if(bench_armed)
+		return;
+
+	bench_arm();
+	event_notify(&bench_q);
+}
+
+static void bench_timer(struct bench_result *res)
+{
+	struct hrtimer *timer;
+
+	bench_start(res);
+	thread_create("timer-peer", &event_peer, NULL, NULL);
+	timer = hrtimer_create(hr_sys_clk, 1000000, &bench_timer_handle,
+			NULL, 0UL);
+
+	while(res->samples < BENCH_SAMPLES)
+		sleep(10);
+
+	hrtimer_stop(timer);
+	bench_armed = false;
+	bench_event_finish();
+}
+
+/*
+ * IRQ: time from a falling edge on INT0 to its handler running.
+ */
+static irqreturn_t bench_irq_handle(struct irq_data *data, void *arg)
+{
+	bench_record();
+	return IRQ_HANDLED;
+}
+
+static void bench_irq(struct bench_result *res)
+{
+	int i;
+
+	bench_start(res);
+
+	DDRD |= BIT(BENCH_IRQ_PIN);
+	PORTD |= BIT(BENCH_IRQ_PIN);
+	irq_request(EXT_IRQ0_VECTOR_NUM, &bench_irq_handle,
+			IRQ_FALLING_MASK, NULL);
+
+	for(i = 0; i < BENCH_SAMPLES; i++) {
+		bench_arm();
+		PORTD &= ~BIT(BENCH_IRQ_PIN);
+		while(bench_armed);
+		PORTD |= BIT(BENCH_IRQ_PIN);
+	}
+
+	EIMSK &= ~BIT(INT0);
+}
+
+int main(void)
+{
+	struct bench_result res;
+
+	printf_P(PSTR("# bench,sched,test,samples,min,max,avg\n"));
+
+	bench_yield(&res);
+	bench_report("yield", &res);
+
+	bench_event(&res);
+	bench_report("event", &res);
+
+	bench_mutex_pingpong(&res);
+	bench_report("mutex", &res);
+
+	bench_timer(&res);
+	bench_report("timer", &res);
+
+	bench_irq(&res);
+	bench_report("irq", &res);
+
+	printf_P(PSTR("# done\n"));
+#ifdef CONFIG_SIMUL_AVR
+	simul_avr_exit(0);
+#endif
+
+	while(true)
+		sleep(1000);
+
+	return -EOK;
+}
@@ -52,6 +52,7 @@ int main(void)
 	printf_P(PSTR("Application started!\n"));
 	ipm_queue_init(&ipm_q, 2);
 
+	memset(&attr, 0, sizeof(attr));
 	attr.prio = 130;
 	attr.stack = test_thread_stack;
 	attr.stack_size = CONFIG_STACK_SIZE;